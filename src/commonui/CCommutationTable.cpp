@@ -151,8 +151,7 @@ void CCommutationTable::onSceneChanged()
 		ui.Table->headerItem()->setText(extraSectionIndex++, paramId);
 	}
 
-	QList<CEdge*> edges = m_scene->getItems<CEdge>();
-	for (auto edge : edges)
+	for (auto edge : m_scene->getEdgesRegistry())
 	{
 		auto item = new NumSortItem();
 		ui.Table->addTopLevelItem(item);
@@ -253,8 +252,7 @@ void CCommutationTable::on_Table_itemSelectionChanged()
 		selIds.insert(item->text(2));
 	}
 
-	QList<CEdge*> edges = m_scene->getItems<CEdge>();
-	for (auto edge : edges)
+	for (auto edge : m_scene->getEdgesRegistry())
 	{
 		if (selIds.contains(edge->getId()))
 		{
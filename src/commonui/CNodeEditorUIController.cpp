@@ -18,6 +18,7 @@ It can be used freely, maintaining the information above.
 #include <CNodePortEditorDialog.h>
 #include <CSearchDialog.h>
 #include <CDOTExportDialog.h>
+#include <CProgressMonitorDialog.h>
 
 #ifdef USE_OGDF
 #include <ogdf/COGDFLayoutUIController.h>
@@ -36,12 +37,15 @@ It can be used freely, maintaining the information above.
 #include <qvge/CEditorSceneDefines.h>
 #include <qvge/CEditorView.h>
 #include <qvge/CFileSerializerGEXF.h>
-#include <qvge/CFileSerializerGraphML.h>
 #include <qvge/CFileSerializerXGR.h>
 #include <qvge/CFileSerializerDOT.h>
 #include <qvge/CFileSerializerCSV.h>
 #include <qvge/ISceneItemFactory.h>
 
+#include <qvgeio/CGraphBase.h>
+#include <qvgeio/CFormatGraphML.h>
+#include <qvgeio/CFormatDOT.h>
+
 #include <QMenuBar>
 #include <QStatusBar>
 #include <QDockWidget>
@@ -52,7 +56,11 @@ It can be used freely, maintaining the information above.
 #include <QDebug>
 #include <QPixmapCache>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentRun>
 
 
 CNodeEditorUIController::CNodeEditorUIController(CMainWindow *parent) :
@@ -61,6 +69,7 @@ CNodeEditorUIController::CNodeEditorUIController(CMainWindow *parent) :
 {
 	// backup timer
 	connect(&m_backupTimer, &QTimer::timeout, this, &CNodeEditorUIController::doBackup);
+	connect(&m_backupWatcher, &QFutureWatcher<qint64>::finished, this, &CNodeEditorUIController::onBackupFinished);
 
     // create document
     m_editorScene = new CNodeEditorScene(parent);
@@ -129,6 +138,8 @@ CNodeEditorUIController::CNodeEditorUIController(CMainWindow *parent) :
 
 CNodeEditorUIController::~CNodeEditorUIController()
 {
+	// let the running backup complete
+	m_backupWatcher.waitForFinished();
 }
 
 
@@ -443,10 +454,10 @@ void CNodeEditorUIController::onSelectionChanged()
 
 void CNodeEditorUIController::onSceneChanged()
 {
-    auto nodes = m_editorScene->getItems<CNode>();
-    auto edges = m_editorScene->getItems<CEdge>();
+    int nodesCount = m_editorScene->getNodesRegistry().size();
+    int edgesCount = m_editorScene->getEdgesRegistry().size();
 
-    m_statusLabel->setText(tr("Nodes: %1 | Edges: %2").arg(nodes.size()).arg(edges.size()));
+    m_statusLabel->setText(tr("Nodes: %1 | Edges: %2").arg(nodesCount).arg(edgesCount));
 
 	updateActions();
 }
@@ -548,10 +559,26 @@ void CNodeEditorUIController::updateSceneOptions()
 	else
 		m_backupTimer.stop();
 
+	updateUndoJournal(m_parent->getCurrentFileName());
+
+	m_editorScene->setFrameBudget(m_optionsData.frameBudget);
+
 	updateActions();
 }
 
 
+void CNodeEditorUIController::updateUndoJournal(const QString &fileName)
+{
+	// undo steps exceeding the limit go to a journal next to the document
+	QString journalPath;
+	if (!fileName.isEmpty())
+		journalPath = QFileInfo(fileName).absolutePath();
+
+	if (!m_editorScene->setUndoMemoryLimit(qint64(m_optionsData.undoMemoryLimit) * 1024 * 1024, journalPath))
+		m_parent->statusBar()->showMessage(tr("Cannot write undo journal, undo history is kept in memory"), 2000);
+}
+
+
 void CNodeEditorUIController::updateActions()
 {
 	if (m_editorScene)
@@ -624,7 +651,15 @@ bool CNodeEditorUIController::doExport(const IFileSerializer &exporter)
 
 void CNodeEditorUIController::exportFile()
 {
-    doExport(CImageExport());
+	bool ok = false;
+	int dpi = QInputDialog::getInt(m_parent, tr("Export to Image"), tr("Resolution (DPI):"),
+		m_lastExportDPI, 24, 4800, 24, &ok);
+	if (!ok)
+		return;
+
+	m_lastExportDPI = dpi;
+
+    doExport(CImageExport(dpi));
 }
 
 
@@ -659,15 +694,69 @@ void CNodeEditorUIController::doBackup()
 		backupFileName = CUtils::cutLastSuffix(backupFileName) + ".bak.xgr";
 	}
 
+	// previous one is still being written: skip this period
+	if (m_backupWatcher.isRunning())
+		return;
+
+	// the snapshot is taken here, the writing goes on a worker thread
+	QElapsedTimer timer;
+	timer.start();
+
+	CFileSerializerXGR::Snapshot previous = m_backupSnapshot;
+	CFileSerializerXGR::Snapshot snapshot;
+	CFileSerializerXGR::takeSnapshot(*m_editorScene, snapshot, &previous);
+	m_backupSnapshot = snapshot;
+
+	// base file + journal of the changes since it was written
+	bool fullBackup = m_backupNeedsBase || backupFileName != m_backupFileName;
+	m_backupNeedsBase = false;
+
+	m_backupSnapshotTime = timer.elapsed();
+	m_backupFileName = backupFileName;
+
 	m_parent->statusBar()->showMessage(tr("Running backup... (%1)").arg(backupFileName));
-	qApp->processEvents();
 
-	CFileSerializerXGR writer;
-	if (writer.save(backupFileName, *m_editorScene)) {
-		m_parent->statusBar()->showMessage(tr("Backup done (%1)").arg(backupFileName), 2000);
+	m_backupWatcher.setFuture(QtConcurrent::run([previous, snapshot, backupFileName, fullBackup]() -> qint64
+	{
+		QElapsedTimer writeTimer;
+		writeTimer.start();
+
+		CFileSerializerXGR writer;
+		bool compact = fullBackup;
+
+		if (!compact)
+		{
+			qint64 journalSize = writer.appendJournal(backupFileName, previous, snapshot);
+
+			// compact when replaying the journal would cost more than reading the base
+			const qint64 minJournalSize = 1024 * 1024;
+			compact = (journalSize < 0 || journalSize > qMax(minJournalSize, QFileInfo(backupFileName).size() / 2));
+		}
+
+		if (compact)
+		{
+			if (!writer.save(backupFileName, snapshot) || !writer.resetJournal(backupFileName))
+				return -1;
+		}
+
+		return writeTimer.elapsed();
+	}));
+}
+
+
+void CNodeEditorUIController::onBackupFinished()
+{
+	qint64 writeTime = m_backupWatcher.result();
+
+	if (writeTime >= 0) {
+		m_parent->statusBar()->showMessage(tr("Backup done (%1): snapshot %2 ms, writing %3 ms")
+			.arg(m_backupFileName).arg(m_backupSnapshotTime).arg(writeTime), 2000);
 	}
 	else {
-		m_parent->statusBar()->showMessage(tr("Backup failed (%1)").arg(backupFileName), 2000);
+		// the journal could be broken: start over
+		m_backupNeedsBase = true;
+
+		m_parent->statusBar()->showMessage(tr("Backup failed (%1)").arg(m_backupFileName), 2000);
 	}
 }
 
@@ -685,9 +774,12 @@ void CNodeEditorUIController::doReadSettings(QSettings& settings)
     QPixmapCache::setCacheLimit(cacheRam);
 
     m_lastExportPath = settings.value("lastExportPath", m_lastExportPath).toString();
+	m_lastExportDPI = settings.value("lastExportDPI", m_lastExportDPI).toInt();
     
 	m_optionsData.newGraphDialogOnStart = settings.value("autoCreateGraphDialog", m_optionsData.newGraphDialogOnStart).toBool();
 	m_optionsData.backupPeriod = settings.value("backupPeriod", m_optionsData.backupPeriod).toInt();
+	m_optionsData.undoMemoryLimit = settings.value("undoMemoryLimit", m_optionsData.undoMemoryLimit).toInt();
+	m_optionsData.frameBudget = settings.value("frameBudget", m_optionsData.frameBudget).toInt();
 
 	updateSceneOptions();
 
@@ -716,9 +808,12 @@ void CNodeEditorUIController::doWriteSettings(QSettings& settings)
     settings.setValue("cacheRam", cacheRam);
 
     settings.setValue("lastExportPath", m_lastExportPath);
+	settings.setValue("lastExportDPI", m_lastExportDPI);
 
     settings.setValue("autoCreateGraphDialog", m_optionsData.newGraphDialogOnStart);
 	settings.setValue("backupPeriod", m_optionsData.backupPeriod);
+	settings.setValue("undoMemoryLimit", m_optionsData.undoMemoryLimit);
+	settings.setValue("frameBudget", m_optionsData.frameBudget);
 
 
     // UI elements
@@ -750,21 +845,71 @@ void CNodeEditorUIController::doWriteSettings(QSettings& settings)
 }
 
 
+// stops the timer for the lifetime of the object
+
+class CTimerPause
+{
+public:
+	CTimerPause(QTimer& timer) : m_timer(timer), m_active(timer.isActive())
+	{
+		m_timer.stop();
+	}
+
+	~CTimerPause()
+	{
+		if (m_active)
+			m_timer.start();
+	}
+
+private:
+	QTimer& m_timer;
+	bool m_active;
+};
+
+
 bool CNodeEditorUIController::loadFromFile(const QString &fileName, const QString &format, QString* lastError)
 {
+	// no backups of the scene being filled
+	CTimerPause backupPause(m_backupTimer);
+
     if (format == "xgr")
     {
-        return (CFileSerializerXGR().load(fileName, *m_editorScene, lastError));
-    }
+		CFileSerializerXGR xgr;
 
-    if (format == "graphml")
-    {
-        return (CFileSerializerGraphML().load(fileName, *m_editorScene, lastError));
+		// the older stream format is restored right into the scene
+		if (!CFileSerializerXGR::isIndexed(fileName))
+			return (xgr.load(fileName, *m_editorScene, lastError));
+
+		CFileSerializerXGR::Snapshot snapshot;
+
+		return loadInBackground(fileName,
+			[&](IProgressMonitor* monitor) { return xgr.read(fileName, snapshot, lastError, monitor); },
+			[&](IProgressMonitor* monitor) { return xgr.restore(snapshot, *m_editorScene, lastError, monitor); },
+			lastError);
     }
 
+	// the others are read into the graph model
+	std::function<bool(Graph&, IProgressMonitor*)> readGraph;
+
+	if (format == "graphml")
+	{
+		readGraph = [&](Graph& graph, IProgressMonitor* monitor) {
+			return CFormatGraphML().load(fileName, graph, lastError, monitor);
+		};
+	}
+
+	if (format == "dot" || format == "gv")
+	{
+		readGraph = [&](Graph& graph, IProgressMonitor* monitor) {
+			return CFormatDOT().load(fileName, graph, lastError, monitor);
+		};
+	}
+
     if (format == "gexf")
     {
-        return (CFileSerializerGEXF().load(fileName, *m_editorScene, lastError));
+		readGraph = [&](Graph& graph, IProgressMonitor* monitor) {
+			return CFileSerializerGEXF().load(fileName, graph, lastError, monitor);
+		};
     }
 
     if (format == "csv")
@@ -787,9 +932,21 @@ bool CNodeEditorUIController::loadFromFile(const QString &fileName, const QStrin
             default:    csvLoader.setDelimiter('\t');   break;
         }
 
-        return (csvLoader.load(fileName, *m_editorScene, lastError));
+		readGraph = [=](Graph& graph, IProgressMonitor* monitor) {
+			return csvLoader.load(fileName, graph, lastError, monitor);
+		};
     }
 
+	if (readGraph)
+	{
+		Graph graph;
+
+		return loadInBackground(fileName,
+			[&](IProgressMonitor* monitor) { return readGraph(graph, monitor); },
+			[&](IProgressMonitor* monitor) { return m_editorScene->fromGraph(graph, monitor); },
+			lastError);
+	}
+
     // else via ogdf
 #ifdef USE_OGDF
     return (COGDFLayout::loadGraph(fileName, *m_editorScene, lastError));
@@ -799,24 +956,83 @@ bool CNodeEditorUIController::loadFromFile(const QString &fileName, const QStrin
 }
 
 
+bool CNodeEditorUIController::loadInBackground(const QString &fileName,
+	std::function<bool(IProgressMonitor*)> read, std::function<bool(IProgressMonitor*)> create, QString* lastError)
+{
+	CProgressMonitorDialog progress(tr("Loading %1...").arg(QFileInfo(fileName).fileName()), m_parent);
+
+	bool ok = progress.runInBackground([&]() {
+		return read(&progress);
+	});
+
+	if (ok)
+	{
+		progress.setLabelText(tr("Creating items..."));
+
+		ok = create(&progress);
+	}
+
+	// cancelled by user: nothing to report
+	if (progress.isCancelled() && lastError)
+		lastError->clear();
+
+	return ok;
+}
+
+
 bool CNodeEditorUIController::saveToFile(const QString &fileName, const QString &format, QString* lastError)
 {
+	CTimerPause backupPause(m_backupTimer);
+
+	// the data are taken from the scene here, the file is written on a worker thread
     if (format == "xgr")
-        return (CFileSerializerXGR().save(fileName, *m_editorScene, lastError));
+	{
+		CFileSerializerXGR::Snapshot snapshot;
+		CFileSerializerXGR::takeSnapshot(*m_editorScene, snapshot);
+
+		return saveInBackground(fileName, [&]() {
+			return CFileSerializerXGR().save(fileName, snapshot, lastError);
+		});
+	}
 
     if (format == "dot" || format == "gv")
-        return (CFileSerializerDOT().save(fileName, *m_editorScene, lastError));
+	{
+		CFileSerializerDOT dot;
+		CFileSerializerDOT::Document document;
+		dot.capture(*m_editorScene, fileName, document);
 
-    if (format == "gexf")
-        return (CFileSerializerGEXF().save(fileName, *m_editorScene, lastError));
+		return saveInBackground(fileName, [&]() {
+			return dot.save(fileName, document, lastError);
+		});
+	}
 
-	if (format == "graphml")
-		return (CFileSerializerGraphML().save(fileName, *m_editorScene, lastError));
+	if (format == "gexf" || format == "graphml")
+	{
+		Graph graph;
+		if (!m_editorScene->toGraph(graph))
+			return false;
+
+		return saveInBackground(fileName, [&]() {
+			if (format == "gexf")
+				return CFileSerializerGEXF().save(fileName, graph, lastError);
+			else
+				return CFormatGraphML().save(fileName, graph, lastError);
+		});
+	}
 
     return false;
 }
 
 
+bool CNodeEditorUIController::saveInBackground(const QString &fileName, std::function<bool()> write)
+{
+	CProgressMonitorDialog progress(tr("Saving %1...").arg(QFileInfo(fileName).fileName()), m_parent);
+	progress.setCancelButton(nullptr);
+
+	return progress.runInBackground(write);
+}
+
+
 void CNodeEditorUIController::readDefaultSceneSettings()
 {
 	QSettings& settings = m_parent->getApplicationSettings();
@@ -905,6 +1121,8 @@ void CNodeEditorUIController::onNewDocumentCreated()
 
 void CNodeEditorUIController::onDocumentLoaded(const QString &fileName)
 {
+	updateUndoJournal(fileName);
+
 	QSettings& settings = m_parent->getApplicationSettings();
 
 	// read custom topology of the current document
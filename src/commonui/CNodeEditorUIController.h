@@ -15,9 +15,14 @@ It can be used freely, maintaining the information above.
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsItem>
 #include <QTimer>
+#include <QFutureWatcher>
+
+#include <functional>
 
 #include <slider2d.h>
 
+#include <qvge/CFileSerializerXGR.h>
+
 #include <commonui/CSceneOptionsDialog.h>
 
 
@@ -27,6 +32,7 @@ class CNodeEditorScene;
 class CNodePort;
 class CEditorView;
 class IFileSerializer;
+class IProgressMonitor;
 class CDOTExportDialog;
 
 
@@ -61,6 +67,7 @@ private Q_SLOTS:
 	void exportDOT();
 
 	void doBackup();
+	void onBackupFinished();
 
 	void onNavigatorShown();
 
@@ -105,6 +112,13 @@ private:
 	void writeDefaultSceneSettings();
 
 	void updateSceneOptions();
+	void updateUndoJournal(const QString &fileName);
+
+	// read() goes on a worker thread, create() fills the scene by time slices; both report to the progress dialog
+	bool loadInBackground(const QString &fileName, std::function<bool(IProgressMonitor*)> read, std::function<bool(IProgressMonitor*)> create, QString* lastError);
+
+	// write() goes on a worker thread (the data have to be taken from the scene before)
+	bool saveInBackground(const QString &fileName, std::function<bool()> write);
 
 	void updateActions();
 	void updateFromActions();
@@ -144,10 +158,16 @@ private:
 
 
 	QString m_lastExportPath;
+	int m_lastExportDPI = 96;
 
 	OptionsData m_optionsData;
 
 	QTimer m_backupTimer;
+	CFileSerializerXGR::Snapshot m_backupSnapshot;	// last one, shares unchanged items with the next
+	QFutureWatcher<qint64> m_backupWatcher;			// result: time of writing (ms) or -1 if failed
+	QString m_backupFileName;
+	bool m_backupNeedsBase = true;					// full backup has to be written before journaling
+	qint64 m_backupSnapshotTime = 0;
 
 #ifdef USE_OGDF
 	class COGDFLayoutUIController *m_ogdfController;
@@ -0,0 +1,107 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#include "CProgressMonitorDialog.h"
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
+
+
+CProgressMonitorDialog::CProgressMonitorDialog(const QString& text, QWidget *parent)
+	: QProgressDialog(text, tr("Cancel"), 0, 0, parent)
+{
+	// shown at once: the events are processed while the job runs, so the window must not take the input
+	setWindowModality(Qt::WindowModal);
+	setMinimumDuration(0);
+	setAutoReset(false);
+	setAutoClose(false);
+
+	connect(this, SIGNAL(canceled()), this, SLOT(onCancelled()));
+
+	m_updateTimer.setInterval(100);
+	connect(&m_updateTimer, SIGNAL(timeout()), this, SLOT(updateProgress()));
+
+	m_sliceTimer.start();
+}
+
+
+bool CProgressMonitorDialog::runInBackground(std::function<bool()> job)
+{
+	QEventLoop loop;
+	QFutureWatcher<bool> watcher;
+	connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+
+	show();
+
+	watcher.setFuture(QtConcurrent::run(job));
+
+	m_updateTimer.start();
+
+	// the job could be done before the loop started
+	if (!watcher.isFinished())
+		loop.exec();
+
+	m_updateTimer.stop();
+
+	updateProgress();
+
+	return watcher.result();
+}
+
+
+bool CProgressMonitorDialog::onProgress(qint64 value, qint64 total)
+{
+	m_value.store(value);
+	m_total.store(total);
+
+	// GUI thread: give the events a chance once per slice
+	if (QThread::currentThread() == thread() && m_sliceTimer.elapsed() >= m_timeSlice)
+	{
+		if (!isVisible())
+			show();
+
+		updateProgress();
+
+		QCoreApplication::processEvents();
+
+		m_sliceTimer.restart();
+	}
+
+	return !isCancelled();
+}
+
+
+void CProgressMonitorDialog::onCancelled()
+{
+	m_cancelled.store(1);
+}
+
+
+void CProgressMonitorDialog::updateProgress()
+{
+	if (isCancelled())
+		return;
+
+	qint64 total = m_total.load();
+	if (total <= 0)
+	{
+		// unknown: busy indicator
+		setRange(0, 0);
+		setValue(0);
+		return;
+	}
+
+	qint64 value = qBound<qint64>(0, m_value.load(), total);
+
+	setRange(0, 1000);
+	setValue(int(value * 1000 / total));
+}
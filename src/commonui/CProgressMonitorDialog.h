@@ -0,0 +1,61 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QProgressDialog>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <functional>
+
+#include <qvgeio/IProgressMonitor.h>
+
+
+/**
+	Modal progress of a long file operation, with the Cancel button. It is shown at once to block the input.
+	Jobs passed to runInBackground() are executed on a worker thread while the GUI keeps running;
+	onProgress() can be called from the worker as well as from the GUI thread, where it processes
+	pending events once per time slice.
+*/
+class CProgressMonitorDialog : public QProgressDialog, public IProgressMonitor
+{
+	Q_OBJECT
+
+public:
+	explicit CProgressMonitorDialog(const QString& text, QWidget *parent = nullptr);
+
+	// runs the job on a worker thread & waits for it processing the events; returns result of the job
+	bool runInBackground(std::function<bool()> job);
+
+	bool isCancelled() const {
+		return m_cancelled.load() != 0;
+	}
+
+	// max. time of GUI thread work between processing of the events, ms
+	void setTimeSlice(int msec) {
+		m_timeSlice = msec;
+	}
+
+	// reimp
+	virtual bool onProgress(qint64 value, qint64 total);
+
+private Q_SLOTS:
+	void onCancelled();
+	void updateProgress();
+
+private:
+	QAtomicInteger<int> m_cancelled;
+	QAtomicInteger<qint64> m_value, m_total;
+
+	QTimer m_updateTimer;
+	QElapsedTimer m_sliceTimer;
+	int m_timeSlice = 40;
+};
@@ -50,6 +50,13 @@ int CSceneOptionsDialog::exec(CEditorScene &scene, CEditorView &view, OptionsDat
     ui->CacheSlider->setMaximum((int)ram);
     ui->CacheSlider->setUnitText(tr("MB"));
 
+	ui->UndoMemorySlider->setMaximum((int)ram);
+	ui->UndoMemorySlider->setValue(data.undoMemoryLimit);
+	ui->UndoMemorySlider->setUnitText(tr("MB"));
+
+	ui->FrameBudgetSlider->setValue(data.frameBudget);
+	ui->FrameBudgetSlider->setUnitText(tr("ms"));
+
 	ui->EnableBackups->setChecked(data.backupPeriod > 0);
 	ui->BackupPeriod->setValue(data.backupPeriod);
 
@@ -75,6 +82,10 @@ int CSceneOptionsDialog::exec(CEditorScene &scene, CEditorView &view, OptionsDat
 
 	QPixmapCache::setCacheLimit(ui->CacheSlider->value() * 1024);
 
+	data.undoMemoryLimit = ui->UndoMemorySlider->value();
+
+	data.frameBudget = ui->FrameBudgetSlider->value();
+
 	data.backupPeriod = ui->EnableBackups->isChecked() ? ui->BackupPeriod->value() : 0;
 
 	data.newGraphDialogOnStart = ui->AutoCreateGraph->isChecked();
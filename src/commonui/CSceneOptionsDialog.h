@@ -25,6 +25,8 @@ struct OptionsData
 {
 	bool newGraphDialogOnStart = true;
 	int backupPeriod = 10;
+	int undoMemoryLimit = 256;	// MB, 0 = unlimited
+	int frameBudget = 30;		// ms, 0 = paint at once
 };
 
 
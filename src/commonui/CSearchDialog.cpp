@@ -81,8 +81,8 @@ void CSearchDialog::on_Find_clicked()
 	ui->Results->clear();
 
 	auto items =
-		ui->EdgesOnly->isChecked() ? m_scene->getItems<CItem, CEdge>() :
-		ui->NodesOnly->isChecked() ? m_scene->getItems<CItem, CNode>() :
+		ui->EdgesOnly->isChecked() ? m_scene->getEdgesRegistry().toList<CItem>() :
+		ui->NodesOnly->isChecked() ? m_scene->getNodesRegistry().toList<CItem>() :
 		m_scene->getItems<CItem>();
 
 	bool lookNames = ui->NamesScope->isChecked();
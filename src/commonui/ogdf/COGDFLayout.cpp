@@ -5,6 +5,7 @@
 #include <qvge/CDirectEdge.h>
 
 #include <ogdf/basic/Graph.h>
+#include <ogdf/basic/NodeArray.h>
 #include <ogdf/basic/GraphAttributes.h>
 #include <ogdf/module/LayoutModule.h>
 #include <ogdf/fileformats/GraphIO.h>
@@ -73,8 +74,8 @@ void COGDFLayout::doLayout(ogdf::LayoutModule &layout, CNodeEditorScene &scene)
     ogdf::GraphAttributes GA(G, ogdf::GraphAttributes::nodeGraphics | ogdf::GraphAttributes::edgeGraphics);
 
     // qvge -> ogdf
-    auto nodes = scene.getItems<CNode>();
-    auto edges = scene.getItems<CEdge>();
+    const auto& nodes = scene.getNodesRegistry();
+    const auto& edges = scene.getEdgesRegistry();
 
     QMap<CNode*, ogdf::node> nodeMap;
 
@@ -125,7 +126,7 @@ void COGDFLayout::graphTopologyToScene(const ogdf::Graph &G, const ogdf::GraphAt
     scene.reset();
 
     // create nodes
-    QMap<ogdf::node, CNode*> nodeMap;
+    ogdf::NodeArray<CNode*> nodeMap(G, nullptr);
 
     for (auto n: G.nodes)
     {
@@ -158,8 +159,8 @@ void COGDFLayout::graphToScene(const ogdf::Graph &G, const ogdf::GraphAttributes
 {
     scene.reset();
 
-    // create nodes
-    QMap<ogdf::node, CNode*> nodeMap;
+    // create nodes (dense array indexed by the node, no allocation per node)
+    ogdf::NodeArray<CNode*> nodeMap(G, nullptr);
 
     for (auto n: G.nodes)
     {
@@ -242,10 +243,25 @@ void COGDFLayout::graphToScene(const ogdf::Graph &G, const ogdf::GraphAttributes
 
 // file IO
 
+// attributes read by graphToScene(); the others are not allocated at all.
+// edgeGraphics is needed by the layout modules when the graph has no positions.
+static const long s_sceneAttributes =
+		ogdf::GraphAttributes::nodeGraphics |
+		ogdf::GraphAttributes::nodeStyle |
+		ogdf::GraphAttributes::nodeId |
+		ogdf::GraphAttributes::nodeLabel |
+		ogdf::GraphAttributes::nodeTemplate |
+		ogdf::GraphAttributes::nodeWeight |
+		ogdf::GraphAttributes::edgeGraphics |
+		ogdf::GraphAttributes::edgeStyle |
+		ogdf::GraphAttributes::edgeLabel |
+		ogdf::GraphAttributes::edgeDoubleWeight;
+
+
 bool COGDFLayout::loadGraph(const QString &filename, CNodeEditorScene &scene, QString* lastError)
 {
     ogdf::Graph G;
-    ogdf::GraphAttributes GA(G, 0xffffff);   // all attrs
+    ogdf::GraphAttributes GA(G, s_sceneAttributes);
 
     QString format = QFileInfo(filename).suffix().toLower();
 
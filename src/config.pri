@@ -12,7 +12,7 @@ win32-msvc*{
 
 
 # common config
-QT += core gui widgets xml opengl network printsupport
+QT += core gui widgets xml opengl network printsupport concurrent
 CONFIG += c++11
 
 
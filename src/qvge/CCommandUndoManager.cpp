@@ -0,0 +1,251 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+
+#include "CCommandUndoManager.h"
+#include "CEditorScene.h"
+#include "CItem.h"
+
+#include <QDataStream>
+
+
+CCommandUndoManager::CCommandUndoManager(CEditorScene & scene)
+	: m_scene(&scene)
+{
+	m_pipeline.setCommitFunction([this](const QByteArray& packedCommand) {
+		m_undoStack << packedCommand;
+	});
+}
+
+void CCommandUndoManager::reset()
+{
+	m_pipeline.clear();
+
+	m_redoStack.clear();
+	m_undoStack.clear();
+
+	m_itemStates.clear();
+	m_sceneState.clear();
+	m_isStarted = false;
+
+	m_changedItems.clear();
+	m_removedItems.clear();
+}
+
+void CCommandUndoManager::addState()
+{
+	// check if 1st store
+	if (!m_isStarted)
+	{
+		storeAllStates();
+		m_isStarted = true;
+		return;
+	}
+
+	Command cmd;
+
+	// removed items
+	for (quint64 uid : m_removedItems)
+	{
+		if (m_itemStates.contains(uid))
+		{
+			cmd.undoStates[uid] = m_itemStates.take(uid);
+			cmd.redoStates[uid] = QByteArray();
+		}
+	}
+
+	// added & changed items
+	for (auto it = m_changedItems.constBegin(); it != m_changedItems.constEnd(); ++it)
+	{
+		QByteArray state = m_scene->storeItemState(*it.value());
+		QByteArray lastState = m_itemStates.value(it.key());
+		if (state == lastState)
+			continue;
+
+		cmd.undoStates[it.key()] = lastState;
+		cmd.redoStates[it.key()] = state;
+		m_itemStates[it.key()] = state;
+	}
+
+	m_changedItems.clear();
+	m_removedItems.clear();
+
+	// scene attributes
+	QByteArray sceneState = m_scene->storeSceneState();
+	if (sceneState != m_sceneState)
+	{
+		cmd.undoSceneState = m_sceneState;
+		cmd.redoSceneState = sceneState;
+		m_sceneState = sceneState;
+	}
+
+	// nothing changed
+	if (cmd.redoStates.isEmpty() && cmd.redoSceneState.isEmpty())
+		return;
+
+	m_pipeline.post([cmd]() {
+		return packCommand(cmd);
+	});
+
+	m_redoStack.clear();
+}
+
+void CCommandUndoManager::revertState()
+{
+	if (!m_isStarted)
+		return;
+
+	// restore the changed items to their last stored states
+	ItemStates itemStates;
+
+	for (quint64 uid : m_removedItems)
+	{
+		if (m_itemStates.contains(uid))
+			itemStates[uid] = m_itemStates[uid];
+	}
+
+	for (quint64 uid : m_changedItems.keys())
+	{
+		itemStates[uid] = m_itemStates.value(uid);
+	}
+
+	applyStates(itemStates, m_sceneState);
+}
+
+void CCommandUndoManager::undo()
+{
+	m_pipeline.flush();
+
+	if (m_undoStack.isEmpty())
+		return;
+
+	Command cmd = unpackCommand(m_undoStack.takeLast());
+	applyStates(cmd.undoStates, cmd.undoSceneState);
+	m_redoStack << cmd;
+}
+
+void CCommandUndoManager::redo()
+{
+	if (m_redoStack.isEmpty())
+		return;
+
+	Command cmd = m_redoStack.takeLast();
+	applyStates(cmd.redoStates, cmd.redoSceneState);
+
+	m_pipeline.post([cmd]() {
+		return packCommand(cmd);
+	});
+}
+
+int CCommandUndoManager::availableUndoCount() const
+{
+	return m_undoStack.size() + m_pipeline.pendingCount();
+}
+
+int CCommandUndoManager::availableRedoCount() const
+{
+	return m_redoStack.size();
+}
+
+bool CCommandUndoManager::setMemoryLimit(qint64 bytes, const QString& journalPath)
+{
+	m_undoStack.setJournalPath(journalPath);
+	return m_undoStack.setMemoryLimit(bytes);
+}
+
+
+// notifications
+
+void CCommandUndoManager::onItemAdded(CItem* item)
+{
+	if (m_isApplying)
+		return;
+
+	m_removedItems.remove(item->uid());
+	m_changedItems[item->uid()] = item;
+}
+
+void CCommandUndoManager::onItemRemoved(CItem* item)
+{
+	// items can be removed as side effect of the restore (i.e. edges of removed nodes)
+	if (m_isApplying)
+	{
+		m_itemStates.remove(item->uid());
+		return;
+	}
+
+	m_changedItems.remove(item->uid());
+	m_removedItems.insert(item->uid());
+}
+
+void CCommandUndoManager::onItemChanged(CItem* item)
+{
+	if (m_isApplying)
+		return;
+
+	m_changedItems[item->uid()] = item;
+}
+
+
+// privates
+
+void CCommandUndoManager::storeAllStates()
+{
+	m_itemStates.clear();
+
+	for (CItem* item : m_scene->getItemsRegistry())
+	{
+		m_itemStates[item->uid()] = m_scene->storeItemState(*item);
+	}
+
+	m_sceneState = m_scene->storeSceneState();
+
+	m_changedItems.clear();
+	m_removedItems.clear();
+}
+
+QByteArray CCommandUndoManager::packCommand(const Command& cmd)
+{
+	QByteArray data;
+	QDataStream ds(&data, QIODevice::WriteOnly);
+	ds << cmd.undoStates << cmd.redoStates << cmd.undoSceneState << cmd.redoSceneState;
+	return data;
+}
+
+CCommandUndoManager::Command CCommandUndoManager::unpackCommand(const QByteArray& data)
+{
+	Command cmd;
+	QDataStream ds(data);
+	ds >> cmd.undoStates >> cmd.redoStates >> cmd.undoSceneState >> cmd.redoSceneState;
+	return cmd;
+}
+
+void CCommandUndoManager::applyStates(const ItemStates& itemStates, const QByteArray& sceneState)
+{
+	m_isApplying = true;
+
+	m_scene->restoreItemStates(itemStates, sceneState);
+
+	// update cached states from the restored items
+	for (auto it = itemStates.constBegin(); it != itemStates.constEnd(); ++it)
+	{
+		if (CItem* item = m_scene->getItemByUid(it.key()))
+			m_itemStates[it.key()] = m_scene->storeItemState(*item);
+		else
+			m_itemStates.remove(it.key());
+	}
+
+	if (sceneState.size())
+		m_sceneState = m_scene->storeSceneState();
+
+	m_changedItems.clear();
+	m_removedItems.clear();
+
+	m_isApplying = false;
+}
@@ -0,0 +1,79 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include "IUndoManager.h"
+#include "CUndoJournal.h"
+#include "CUndoPipeline.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+
+class CEditorScene;
+
+
+// Undo manager storing only the states of the items changed between the undo steps.
+// Items are identified by their uids; the scene notifies the manager about added,
+// removed & changed items, so no full scene snapshots are made after the 1st one.
+
+class CCommandUndoManager : public IUndoManager
+{
+public:
+	CCommandUndoManager(CEditorScene &scene);
+
+	// reimp
+	virtual void reset();
+	virtual void addState();
+	virtual void revertState();
+	virtual void undo();
+	virtual void redo();
+	virtual int availableUndoCount() const;
+	virtual int availableRedoCount() const;
+	virtual bool setMemoryLimit(qint64 bytes, const QString& journalPath = QString());
+
+	virtual void onItemAdded(CItem* item);
+	virtual void onItemRemoved(CItem* item);
+	virtual void onItemChanged(CItem* item);
+
+private:
+	typedef QMap<quint64, QByteArray> ItemStates;
+
+	struct Command
+	{
+		ItemStates undoStates, redoStates;		// empty state: item does not exist
+		QByteArray undoSceneState, redoSceneState;	// empty state: not changed
+	};
+
+	void storeAllStates();
+	void applyStates(const ItemStates& itemStates, const QByteArray& sceneState);
+
+	static QByteArray packCommand(const Command& cmd);
+	static Command unpackCommand(const QByteArray& data);
+
+	CEditorScene *m_scene;
+	QList<Command> m_redoStack;
+	CUndoJournal m_undoStack;	// packed commands
+
+	// last stored states
+	QHash<quint64, QByteArray> m_itemStates;
+	QByteArray m_sceneState;
+	bool m_isStarted = false;
+
+	// changes since the last stored state
+	QHash<quint64, CItem*> m_changedItems;
+	QSet<quint64> m_removedItems;
+	bool m_isApplying = false;
+
+	// commands being packed
+	CUndoPipeline<QByteArray> m_pipeline;
+};
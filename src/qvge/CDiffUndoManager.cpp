@@ -10,22 +10,31 @@ It can be used freely, maintaining the information above.
 
 #include "CDiffUndoManager.h"
 #include "CEditorScene.h"
+#include "CItem.h"
 
+#include <QHash>
 #include <QDataStream>
 
 
 CDiffUndoManager::CDiffUndoManager(CEditorScene & scene)
     : m_scene(&scene)
 {
+	m_pipeline.setCommitFunction([this](const PackedCommands& commands) {
+		m_undoStack << commands.first;
+		m_redoStackTemp << commands.second;
+	});
 }
 
 void CDiffUndoManager::reset()
 {
+	m_pipeline.clear();
+
 	m_redoStack.clear();
 	m_undoStack.clear();
 	m_redoStackTemp.clear();
 	m_undoStackTemp.clear();
 	m_lastState.clear();
+	m_lastSceneState.clear();
 }
 
 void CDiffUndoManager::addState()
@@ -34,84 +43,187 @@ void CDiffUndoManager::addState()
 	m_redoStack.clear();
 	m_undoStackTemp.clear();
 
-	// serialize & compress
-	QByteArray snap;
-	QDataStream ds(&snap, QIODevice::WriteOnly);
-	m_scene->storeTo(ds, true);
+	// serialize the items into chunks
+	QMap<quint64, Chunk> snap;
+
+	for (CItem* item : m_scene->getItemsRegistry())
+	{
+		QByteArray data = m_scene->storeItemState(*item);
+		Chunk chunk = { qHash(data), data };
+		snap[item->uid()] = chunk;
+	}
+
+	QByteArray sceneSnap = m_scene->storeSceneState();
 
 	// check if 1st store
-	if (m_lastState.isEmpty() && m_undoStack.isEmpty() && m_redoStack.isEmpty())
+	if (m_lastSceneState.isEmpty() && m_undoStack.isEmpty() && m_redoStack.isEmpty())
 	{
 		m_lastState = snap;
+		m_lastSceneState = sceneSnap;
 		return;
 	}
 
-	// push states into stacks
-	int leftDiffIndex = 0;
-	int len = qMin(snap.size(), m_lastState.size());
-	while (leftDiffIndex < len && snap[leftDiffIndex] == m_lastState[leftDiffIndex])
-		++leftDiffIndex;
-
-	int rightDiffIndex1 = m_lastState.size() - 1;
-	int rightDiffIndex2 = snap.size() - 1;
-	while (rightDiffIndex1 >= 0 && rightDiffIndex2 >= 0 
-		&& rightDiffIndex1 > leftDiffIndex && rightDiffIndex2 > leftDiffIndex 
-		&& snap[rightDiffIndex2] == m_lastState[rightDiffIndex1])
-			--rightDiffIndex1, --rightDiffIndex2;
+	// compare & pack in background
+	QMap<quint64, Chunk> lastState = m_lastState;
+	QByteArray lastSceneState = m_lastSceneState;
 
-	int len1 = rightDiffIndex1 - leftDiffIndex + 1;
-	int len2 = rightDiffIndex2 - leftDiffIndex + 1;
-
-	Command cUndo = { leftDiffIndex, len2, qCompress(m_lastState.mid(leftDiffIndex, len1)) };
-	Command cRedo = { leftDiffIndex, len1, qCompress(snap.mid(leftDiffIndex, len2)) };
-
-	m_undoStack << cUndo;
-	m_redoStackTemp << cRedo;
+	m_pipeline.post([lastState, lastSceneState, snap, sceneSnap]() {
+		return diffStates(lastState, lastSceneState, snap, sceneSnap);
+	});
 
 	// write last state
 	m_lastState = snap;
+	m_lastSceneState = sceneSnap;
 }
 
 void CDiffUndoManager::revertState()
 {
-	QDataStream ds(&m_lastState, QIODevice::ReadOnly);
-	m_scene->restoreFrom(ds, true);
+	restoreLastState();
 }
 
 void CDiffUndoManager::undo()
 {
+	m_pipeline.flush();
+
 	if (availableUndoCount())
 	{
-		Command cUndo = m_undoStack.takeLast();
-		m_lastState.replace(cUndo.index, cUndo.sizeToReplace, qUncompress(cUndo.data));
-		QDataStream ds(&m_lastState, QIODevice::ReadOnly);
-		m_scene->restoreFrom(ds, true);
+		Command cUndo = unpackCommand(m_undoStack.takeLast());
+		applyCommand(cUndo);
+		restoreLastState();
 
-		m_redoStack << m_redoStackTemp.takeLast();
+		m_redoStack << unpackCommand(m_redoStackTemp.takeLast());
 		m_undoStackTemp << cUndo;
 	}
 }
 
 void CDiffUndoManager::redo()
 {
+	m_pipeline.flush();
+
 	if (availableRedoCount())
 	{
 		Command cRedo = m_redoStack.takeLast();
-		m_lastState.replace(cRedo.index, cRedo.sizeToReplace, qUncompress(cRedo.data));
-		QDataStream ds(&m_lastState, QIODevice::ReadOnly);
-		m_scene->restoreFrom(ds, true);
+		applyCommand(cRedo);
+		restoreLastState();
 
-		m_undoStack << m_undoStackTemp.takeLast();
-		m_redoStackTemp << cRedo;
+		m_undoStack << packCommand(m_undoStackTemp.takeLast());
+		m_redoStackTemp << packCommand(cRedo);
 	}
 }
 
 int CDiffUndoManager::availableUndoCount() const
 {
-	return m_undoStack.size();
+	return m_undoStack.size() + m_pipeline.pendingCount();
 }
 
 int CDiffUndoManager::availableRedoCount() const
 {
 	return m_redoStack.size();
 }
+
+bool CDiffUndoManager::setMemoryLimit(qint64 bytes, const QString& journalPath)
+{
+	// shared by the both journals
+	m_undoStack.setJournalPath(journalPath);
+	bool ok = m_undoStack.setMemoryLimit(bytes / 2);
+	m_redoStackTemp.setJournalPath(journalPath);
+	ok &= m_redoStackTemp.setMemoryLimit(bytes / 2);
+	return ok;
+}
+
+
+// privates
+
+void CDiffUndoManager::applyCommand(const Command& cmd)
+{
+	for (auto it = cmd.chunks.constBegin(); it != cmd.chunks.constEnd(); ++it)
+	{
+		if (it.value().isEmpty())
+		{
+			m_lastState.remove(it.key());
+		}
+		else
+		{
+			Chunk chunk = { qHash(it.value()), it.value() };
+			m_lastState[it.key()] = chunk;
+		}
+	}
+
+	if (cmd.sceneChunk.size())
+		m_lastSceneState = cmd.sceneChunk;
+}
+
+CDiffUndoManager::PackedCommands CDiffUndoManager::diffStates(
+	const QMap<quint64, Chunk>& lastState, const QByteArray& lastSceneState,
+	const QMap<quint64, Chunk>& snap, const QByteArray& sceneSnap)
+{
+	// compare the chunks: both maps are sorted by uids
+	Command cUndo, cRedo;
+
+	auto oldIt = lastState.constBegin();
+	auto newIt = snap.constBegin();
+
+	while (oldIt != lastState.constEnd() || newIt != snap.constEnd())
+	{
+		// removed item
+		if (newIt == snap.constEnd() || (oldIt != lastState.constEnd() && oldIt.key() < newIt.key()))
+		{
+			cUndo.chunks[oldIt.key()] = oldIt.value().data;
+			cRedo.chunks[oldIt.key()] = QByteArray();
+			++oldIt;
+			continue;
+		}
+
+		// added item
+		if (oldIt == lastState.constEnd() || newIt.key() < oldIt.key())
+		{
+			cUndo.chunks[newIt.key()] = QByteArray();
+			cRedo.chunks[newIt.key()] = newIt.value().data;
+			++newIt;
+			continue;
+		}
+
+		// same item: compare hashes first
+		if (oldIt.value().hash != newIt.value().hash || oldIt.value().data != newIt.value().data)
+		{
+			cUndo.chunks[oldIt.key()] = oldIt.value().data;
+			cRedo.chunks[newIt.key()] = newIt.value().data;
+		}
+
+		++oldIt;
+		++newIt;
+	}
+
+	if (sceneSnap != lastSceneState)
+	{
+		cUndo.sceneChunk = lastSceneState;
+		cRedo.sceneChunk = sceneSnap;
+	}
+
+	return qMakePair(packCommand(cUndo), packCommand(cRedo));
+}
+
+QByteArray CDiffUndoManager::packCommand(const Command& cmd)
+{
+	QByteArray data;
+	QDataStream ds(&data, QIODevice::WriteOnly);
+	ds << cmd.chunks << cmd.sceneChunk;
+	return data;
+}
+
+CDiffUndoManager::Command CDiffUndoManager::unpackCommand(const QByteArray& data)
+{
+	Command cmd;
+	QDataStream ds(data);
+	ds >> cmd.chunks >> cmd.sceneChunk;
+	return cmd;
+}
+
+void CDiffUndoManager::restoreLastState()
+{
+	QMap<quint64, QByteArray> itemStates;
+	for (auto it = m_lastState.constBegin(); it != m_lastState.constEnd(); ++it)
+		itemStates[it.key()] = it.value().data;
+
+	m_scene->restoreFromStates(itemStates, m_lastSceneState);
+}
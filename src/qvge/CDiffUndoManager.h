@@ -10,13 +10,21 @@ It can be used freely, maintaining the information above.
 #pragma once
 
 #include "IUndoManager.h"
+#include "CUndoJournal.h"
+#include "CUndoPipeline.h"
 
 #include <QtCore/QByteArray>
 #include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QPair>
 
 class CEditorScene;
 
 
+// Undo manager storing the differences between the scene snapshots.
+// A snapshot is split into chunks (one per item plus one for the scene attributes),
+// so only the chunks which were changed are kept by the undo commands.
+
 class CDiffUndoManager : public IUndoManager
 {
 public:
@@ -30,17 +38,43 @@ public:
 	virtual void redo();
 	virtual int availableUndoCount() const;
 	virtual int availableRedoCount() const;
+	virtual bool setMemoryLimit(qint64 bytes, const QString& journalPath = QString());
 
 private:
-	struct Command
+	struct Chunk
 	{
-		int index;
-		int sizeToReplace;
+		uint hash;
 		QByteArray data;
 	};
 
+	struct Command
+	{
+		QMap<quint64, QByteArray> chunks;	// empty chunk: item has to be removed
+		QByteArray sceneChunk;				// empty: scene attributes not changed
+	};
+
+	void applyCommand(const Command& cmd);
+	void restoreLastState();
+
+	// packed undo & redo commands
+	typedef QPair<QByteArray, QByteArray> PackedCommands;
+
+	static PackedCommands diffStates(
+		const QMap<quint64, Chunk>& lastState, const QByteArray& lastSceneState,
+		const QMap<quint64, Chunk>& snap, const QByteArray& sceneSnap);
+
+	static QByteArray packCommand(const Command& cmd);
+	static Command unpackCommand(const QByteArray& data);
+
 	CEditorScene *m_scene;
-	QList<Command> m_redoStack, m_undoStack;
-	QList<Command> m_redoStackTemp, m_undoStackTemp;
-	QByteArray m_lastState;
+	QList<Command> m_redoStack, m_undoStackTemp;
+	// these are growing with the history, so kept in the journals
+	CUndoJournal m_undoStack, m_redoStackTemp;
+
+	// chunks of the last state sorted by item uids
+	QMap<quint64, Chunk> m_lastState;
+	QByteArray m_lastSceneState;
+
+	// diffs being computed
+	CUndoPipeline<PackedCommands> m_pipeline;
 };
@@ -11,6 +11,7 @@ It can be used freely, maintaining the information above.
 
 #include "CDirectEdge.h"
 #include "CNode.h"
+#include "CEditorSceneDefines.h"
 
 
 CDirectEdge::CDirectEdge(QGraphicsItem *parent): Super(parent)
@@ -61,20 +62,35 @@ void CDirectEdge::paint(QPainter *painter, const QStyleOptionGraphicsItem *optio
 	// called before draw 
     setupPainter(painter, option, widget);
 
-    painter->setClipRect(boundingRect());
-
 	bool isDirect = (!isCircled() && (m_bendFactor == 0));
+
+	// zoomed out: hairline without arrows
+	qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+	if (lod < lod_edge_zoom)
+	{
+		QPen pen = painter->pen();
+		pen.setWidth(0);
+		pen.setStyle(Qt::SolidLine);
+		painter->setPen(pen);
+
+		if (isDirect)
+			painter->drawLine(line());
+		else
+		{
+			painter->setBrush(Qt::NoBrush);
+			painter->drawPath(m_shapeCachePath);
+		}
+
+		return;
+	}
+
+    painter->setClipRect(boundingRect());
 	if (isDirect)	// straight line
 	{
 		//painter->drawLine(line());
 		painter->drawPath(m_shapeCachePath);
 
-        // arrows
-        if (m_itemFlags & CF_Start_Arrow)
-            drawArrow(painter, option, true, QLineF(line().p2(), line().p1()));
-
-        if (m_itemFlags & CF_End_Arrow)
-            drawArrow(painter, option, false, line());
+		drawArrows(painter, option);
 	}
 	else // curve
 	{
@@ -97,6 +113,16 @@ void CDirectEdge::paint(QPainter *painter, const QStyleOptionGraphicsItem *optio
 }
 
 
+void CDirectEdge::drawArrows(QPainter *painter, const QStyleOptionGraphicsItem *option) const
+{
+	if (m_itemFlags & CF_Start_Arrow)
+		drawArrow(painter, option, true, QLineF(line().p2(), line().p1()));
+
+	if (m_itemFlags & CF_End_Arrow)
+		drawArrow(painter, option, false, line());
+}
+
+
 void CDirectEdge::updateLabelPosition()
 {
 	auto r = m_labelItem->boundingRect();
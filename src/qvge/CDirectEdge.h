@@ -34,6 +34,12 @@ public:
 		return m_controlPoint;
 	}
 
+	// straight edges are drawn by lines together with the others of the same pen (see CNodeEditorScene::drawItems)
+	virtual bool isBatchable() const { return !isCircled() && m_bendFactor == 0; }
+
+	// draws arrows of the straight edge with the current pen
+	void drawArrows(QPainter *painter, const QStyleOptionGraphicsItem *option) const;
+
 protected:
 	// reimp
 	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = Q_NULLPTR);
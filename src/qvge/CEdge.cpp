@@ -45,7 +45,7 @@ CEdge::CEdge(QGraphicsItem *parent): Shape(parent)
 	//setCacheMode(DeviceCoordinateCache);
 
 	// label
-	m_labelItem = new QGraphicsSimpleTextItem(this);
+	m_labelItem = new CItemLabel(this);
 	m_labelItem->setFlags(0);
 	m_labelItem->setCacheMode(DeviceCoordinateCache);
 	m_labelItem->setPen(Qt::NoPen);
@@ -55,6 +55,10 @@ CEdge::CEdge(QGraphicsItem *parent): Shape(parent)
 
 CEdge::~CEdge()
 {
+	// scene item is still alive here (unlike in ~CItem)
+	if (auto editorScene = getScene())
+		editorScene->onItemDestroyed(this);
+
 	if (m_firstNode)
 		m_firstNode->onConnectionDeleted(this);
 
@@ -108,6 +112,9 @@ void CEdge::updateCachedItems()
 {
 	Super::updateCachedItems();
 
+	// attributes of the class could be changed as well
+	m_paintCache.revision = 0;
+
 	updateArrowFlags(getAttribute(QByteArrayLiteral("direction")).toString());
 }
 
@@ -144,34 +151,50 @@ QRectF CEdge::boundingRect() const
 }
 
 
-void CEdge::setupPainter(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget* /*widget*/)
+void CEdge::updatePaintCache()
 {
+	m_paintCache.revision = revision();
+
 	// weight
 	bool ok = false;
 	double weight = qMax(0.1, getAttribute(QByteArrayLiteral("weight")).toDouble(&ok));
 	if (!ok) weight = 1;
 	if (weight > 10) weight = 10;	// safety
+	m_paintCache.weight = weight;
 
 	// line style
-	Qt::PenStyle penStyle = (Qt::PenStyle) CUtils::textToPenStyle(getAttribute(QByteArrayLiteral("style")).toString(), Qt::SolidLine);
+	m_paintCache.penStyle = (Qt::PenStyle) CUtils::textToPenStyle(getAttribute(QByteArrayLiteral("style")).toString(), Qt::SolidLine);
 
+	m_paintCache.color = getAttribute(QByteArrayLiteral("color")).value<QColor>();
+}
+
+
+QPen CEdge::getPaintPen()
+{
+	if (m_paintCache.revision != revision())
+		updatePaintCache();
+
+	return QPen(m_paintCache.color, m_paintCache.weight, m_paintCache.penStyle, Qt::FlatCap, Qt::MiterJoin);
+}
+
+
+void CEdge::setupPainter(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget* /*widget*/)
+{
 	// color & selection
 	bool isSelected = (option->state & QStyle::State_Selected);
     if (isSelected)
     {
-		QPen p(QColor(Qt::darkCyan), weight + 1.0, penStyle, Qt::FlatCap, Qt::MiterJoin);
+		if (m_paintCache.revision != revision())
+			updatePaintCache();
+
+		QPen p(QColor(Qt::darkCyan), m_paintCache.weight + 1.0, m_paintCache.penStyle, Qt::FlatCap, Qt::MiterJoin);
 		painter->setOpacity(0.5);
         painter->setPen(p);
     }
     else
 	{
-		// get color (to optimize!)
-		QColor color = getAttribute(QByteArrayLiteral("color")).value<QColor>();
-
-		QPen p(color, weight, penStyle, Qt::FlatCap, Qt::MiterJoin);
-
 		painter->setOpacity(1.0);
-		painter->setPen(p);
+		painter->setPen(getPaintPen());
 	}
 }
 
@@ -248,7 +271,8 @@ bool CEdge::storeTo(QDataStream &out, quint64 version64) const
 {
 	Super::storeTo(out, version64);
 
-    out << quint64(m_firstNode) << quint64(m_lastNode);
+	// nodes are referred by their uids
+	out << (m_firstNode ? m_firstNode->uid() : quint64(0)) << (m_lastNode ? m_lastNode->uid() : quint64(0));
 
 	// since version 11
 	out << m_firstPortId << m_lastPortId;
@@ -259,6 +283,13 @@ bool CEdge::storeTo(QDataStream &out, quint64 version64) const
 
 bool CEdge::restoreFrom(QDataStream &out, quint64 version64)
 {
+	// detach from the nodes if restoring in place
+	if (m_firstNode || m_lastNode)
+	{
+		setFirstNode(NULL);
+		setLastNode(NULL);
+	}
+
 	if (Super::restoreFrom(out, version64))
 	{
 		// these are TEMP ids
@@ -312,6 +343,8 @@ void CEdge::setFirstNode(CNode *node, const QByteArray& portId)
         m_firstNode->onConnectionAttach(this);
 
 	onParentGeometryChanged();
+
+	notifyItemChanged();
 }
 
 
@@ -329,6 +362,8 @@ void CEdge::setLastNode(CNode *node, const QByteArray& portId)
         m_lastNode->onConnectionAttach(this);
 
 	onParentGeometryChanged();
+
+	notifyItemChanged();
 }
 
 
@@ -375,6 +410,8 @@ void CEdge::reverse()
 	qSwap(m_firstPortId, m_lastPortId);
 
 	onParentGeometryChanged();
+
+	notifyItemChanged();
 }
 
 
@@ -434,6 +471,8 @@ void CEdge::onNodePortRenamed(CNode *node, const QByteArray& portId, const QByte
 
 	if (m_lastNode == node && m_lastPortId == oldPortId)
 		m_lastPortId = portId;
+
+	notifyItemChanged();
 }
 
 
@@ -449,11 +488,24 @@ void CEdge::onItemRestored()
 
 QVariant CEdge::itemChange(QGraphicsItem::GraphicsItemChange change, const QVariant &value)
 {
+	if (change == ItemSceneChange)
+	{
+		// leave id index of the old scene
+		if (auto editorScene = getScene())
+			editorScene->onItemRemoved(this);
+
+		return value;
+	}
+
 	if (change == ItemSceneHasChanged)
 	{
 		// set default ID
 		setDefaultId();
 
+		// join id index of the new scene
+		if (auto editorScene = getScene())
+			editorScene->onItemAdded(this);
+
 		onItemRestored();
 
 		return value;
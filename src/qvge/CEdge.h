@@ -63,6 +63,9 @@ public:
 	virtual QPainterPath shape() const;
 	virtual QRectF boundingRect() const;
 
+	// pen of the unselected edge
+	QPen getPaintPen();
+
 	// attributes
 	virtual bool hasLocalAttribute(const QByteArray& attrId) const;
 	virtual bool setAttribute(const QByteArray& attrId, const QVariant& v);
@@ -96,6 +99,7 @@ protected:
 	// cached attributes
 	virtual void updateCachedItems();
 	virtual void updateArrowFlags(const QString& direction);
+	void updatePaintCache();
 
 protected:
     union{
@@ -112,6 +116,17 @@ protected:
 
 	QPainterPath m_selectionShapePath;
 	QPainterPath m_shapeCachePath;
+
+	// attributes used by setupPainter(), taken again when the item or its class has been changed
+	struct PaintCache
+	{
+		quint64 revision = 0;
+		qreal weight = 1;
+		Qt::PenStyle penStyle = Qt::SolidLine;
+		QColor color;
+	};
+
+	PaintCache m_paintCache;
 };
 
 
@@ -15,6 +15,7 @@ It can be used freely, maintaining the information above.
 #include "CControlPoint.h"
 #include "CSimpleUndoManager.h"
 #include "CDiffUndoManager.h"
+#include "CCommandUndoManager.h"
 #include "IContextMenuProvider.h"
 #include "ISceneItemFactory.h"
 #include "ISceneMenuController.h"
@@ -29,15 +30,20 @@ It can be used freely, maintaining the information above.
 #include <QInputDialog>
 #include <QMimeData>
 #include <QClipboard>
+#include <QBuffer>
 #include <QDebug>
 #include <QElapsedTimer>
 #include <QPixmapCache> 
+#include <QStyleOptionGraphicsItem>
+
+#include <cmath>
 
 #include <qopengl.h>
 
 
 const quint64 version64 = 12;	// build
 const char* versionId = "VersionId";
+const quint32 s_selectionMarker = 0x51564753;	// "QVGS": compressed selection
 
 
 CEditorScene::CEditorScene(QObject *parent): QGraphicsScene(parent), 
@@ -46,7 +52,8 @@ CEditorScene::CEditorScene(QObject *parent): QGraphicsScene(parent),
     m_startDragItem(NULL),
 	m_infoStatus(-1),
     //m_undoManager(new CSimpleUndoManager(*this)),
-	m_undoManager(new CDiffUndoManager(*this)),
+	//m_undoManager(new CDiffUndoManager(*this)),
+	m_undoManager(new CCommandUndoManager(*this)),
 	m_menuTriggerItem(NULL),
     m_draggedItem(NULL),
     m_needUpdateItems(true),
@@ -147,6 +154,10 @@ void CEditorScene::removeItems()
 
 	clear();
 
+	m_itemsRegistry.clear();
+	m_itemsById.clear();
+	m_itemsByUid.clear();
+
 	CItem::endRestore();
 }
 
@@ -293,6 +304,15 @@ void CEditorScene::setInitialState()
 }
 
 
+bool CEditorScene::setUndoMemoryLimit(qint64 bytes, const QString& journalPath)
+{
+	if (m_undoManager)
+		return m_undoManager->setMemoryLimit(bytes, journalPath);
+
+	return true;
+}
+
+
 int CEditorScene::availableUndoCount() const
 { 
 	return m_undoManager ? m_undoManager->availableUndoCount() : 0; 
@@ -318,23 +338,17 @@ bool CEditorScene::storeTo(QDataStream& out, bool storeOptions) const
 {
     out << versionId << version64;
 
-	// items
-	QMap<CItem*, uint> sortedMap;
+	// items (sorted by uids, so the order is stable between the stores)
+	QMap<quint64, CItem*> sortedMap;
 
-	QList<QGraphicsItem*> allItems = items();
-
-	for (QGraphicsItem* item : allItems)
+	for (CItem* citem : m_itemsRegistry)
 	{
-		CItem* citem = dynamic_cast<CItem*>(item);
-		if (citem)
-		{
-            sortedMap[citem] = quint64(citem);
-		}
+		sortedMap[citem->uid()] = citem;
 	}
 
-	for (CItem* citem : sortedMap.keys())
+	for (CItem* citem : sortedMap)
 	{
-        out << citem->typeId() << quint64(citem);
+        out << citem->typeId() << citem->uid();
 
 		citem->storeTo(out, version64);
 	}
@@ -343,6 +357,12 @@ bool CEditorScene::storeTo(QDataStream& out, bool storeOptions) const
 	out << QByteArray("_attr_");
 	out << (quint64)0x12345678;
 
+	return storeAttributesTo(out, storeOptions);
+}
+
+
+bool CEditorScene::storeAttributesTo(QDataStream& out, bool storeOptions) const
+{
 	out << m_classAttributes.size();
 	for (auto classAttrsIt = m_classAttributes.constBegin(); classAttrsIt != m_classAttributes.constEnd(); ++classAttrsIt)
 	{
@@ -406,6 +426,9 @@ bool CEditorScene::restoreFrom(QDataStream& out, bool readOptions)
 			if (item->restoreFrom(out, storedVersion))
 			{
                 idToItem[ptrId] = item;
+
+				// keep the stored identity
+				item->setUid(ptrId);
 				continue;
 			}
 		}
@@ -439,6 +462,27 @@ bool CEditorScene::restoreFrom(QDataStream& out, bool readOptions)
 	}
 
 	// attributes
+	if (!restoreAttributesFrom(out, storedVersion, readOptions))
+	{
+		CItem::endRestore();
+
+		return false;
+	}
+
+	// finish
+	CItem::endRestore();
+
+	for (CItem* item : idToItem.values())
+	{
+		item->onItemRestored();
+	}
+
+	return true;
+}
+
+
+bool CEditorScene::restoreAttributesFrom(QDataStream& out, quint64 storedVersion, bool readOptions)
+{
 	if (storedVersion >= 3)
 	{
 		int classAttrSize = 0;
@@ -464,11 +508,7 @@ bool CEditorScene::restoreFrom(QDataStream& out, bool readOptions)
 					setClassAttribute(classId, attr);
 				}
 				else
-				{
-					CItem::endRestore();
-
 					return false;
-				}
 			}
 		}
 	}
@@ -498,10 +538,185 @@ bool CEditorScene::restoreFrom(QDataStream& out, bool readOptions)
 		setSceneRect(sr);
 	}
 
-	// finish
+	return true;
+}
+
+
+// partial io
+
+quint64 CEditorScene::dataVersion()
+{
+	return version64;
+}
+
+
+QByteArray CEditorScene::storeItemState(const CItem& item) const
+{
+	auto it = m_cachedStates.constFind(item.uid());
+	if (it != m_cachedStates.constEnd() && it.value().revision == item.revision())
+		return it.value().state;
+
+	QByteArray state;
+	QDataStream out(&state, QIODevice::WriteOnly);
+
+	// same layout as the items section of storeTo()
+	out << item.typeId() << item.uid();
+	item.storeTo(out, version64);
+
+	CachedState cached = { item.revision(), state };
+	m_cachedStates[item.uid()] = cached;
+
+	return state;
+}
+
+
+QByteArray CEditorScene::storeSceneState() const
+{
+	QByteArray state;
+	QDataStream out(&state, QIODevice::WriteOnly);
+
+	storeAttributesTo(out, true);
+
+	return state;
+}
+
+
+bool CEditorScene::restoreFromStates(const QMap<quint64, QByteArray>& itemStates, const QByteArray& sceneState, bool readOptions)
+{
+	// compare with the live items by uids: only the different ones will be restored
+	QMap<quint64, QByteArray> changedStates;
+
+	for (CItem* item : m_itemsRegistry)
+	{
+		if (!itemStates.contains(item->uid()))
+			changedStates[item->uid()] = QByteArray();
+	}
+
+	for (auto it = itemStates.constBegin(); it != itemStates.constEnd(); ++it)
+	{
+		CItem* item = m_itemsByUid.value(it.key());
+		if (item == NULL)
+		{
+			changedStates[it.key()] = it.value();
+			continue;
+		}
+
+		// changed since its state was stored: has to be restored
+		auto cachedIt = m_cachedStates.constFind(it.key());
+		if (cachedIt == m_cachedStates.constEnd() || cachedIt.value().revision != item->revision())
+		{
+			changedStates[it.key()] = it.value();
+			continue;
+		}
+
+		// states coming from storeItemState() are mostly shared, so the data are not compared
+		const QByteArray& cachedState = cachedIt.value().state;
+		bool isSame = (cachedState.constData() == it.value().constData() && cachedState.size() == it.value().size())
+			|| cachedState == it.value();
+
+		if (!isSame)
+			changedStates[it.key()] = it.value();
+	}
+
+	// scene attributes (without options they cannot be compared)
+	QByteArray changedSceneState = sceneState;
+	if (readOptions && sceneState == storeSceneState())
+		changedSceneState.clear();
+
+	if (changedStates.isEmpty() && changedSceneState.isEmpty())
+		return true;
+
+	return restoreItemStates(changedStates, changedSceneState, readOptions);
+}
+
+
+bool CEditorScene::restoreItemStates(const QMap<quint64, QByteArray>& itemStates, const QByteArray& sceneState, bool readOptions,
+	quint64 storedVersion)
+{
+	// scene attributes
+	if (sceneState.size())
+	{
+		m_classAttributes.clear();
+
+		QDataStream in(sceneState);
+		if (!restoreAttributesFrom(in, storedVersion, readOptions))
+			return false;
+	}
+
+	// remove items which are not existing in the states anymore
+	QSet<CItem*> restoredItems;
+
+	for (auto it = itemStates.constBegin(); it != itemStates.constEnd(); ++it)
+	{
+		CItem* item = m_itemsByUid.value(it.key());
+		if (item == NULL)
+			continue;
+
+		// typeId is stored first
+		QByteArray typeId;
+		if (it.value().size())
+		{
+			QDataStream in(it.value());
+			in >> typeId;
+		}
+
+		if (typeId != item->typeId())
+			delete dynamic_cast<QGraphicsItem*>(item);
+	}
+
+	// restore existing items in place or create the new ones
+	CItem::beginRestore();
+
+	for (auto it = itemStates.constBegin(); it != itemStates.constEnd(); ++it)
+	{
+		if (it.value().isEmpty())
+			continue;
+
+		QDataStream in(it.value());
+		QByteArray typeId; in >> typeId;
+		quint64 uid; in >> uid;
+
+		CItem* item = m_itemsByUid.value(it.key());
+		if (item)
+		{
+			QString oldId = item->getId();
+
+			if (!item->restoreFrom(in, storedVersion))
+				continue;
+
+			if (oldId != item->getId())
+				onItemIdChanged(item, oldId);
+
+			item->setItemStateFlag(IS_Attribute_Changed);
+		}
+		else
+		{
+			item = createItemOfType(typeId);
+			if (item == NULL)
+				continue;
+
+			if (!item->restoreFrom(in, storedVersion))
+			{
+				delete item;
+				continue;
+			}
+
+			item->setUid(it.key());
+			addItem(dynamic_cast<QGraphicsItem*>(item));
+		}
+
+		restoredItems << item;
+	}
+
+	// relink the restored items against the whole scene
+	for (CItem* item : restoredItems)
+	{
+		item->linkAfterRestore(m_itemsByUid);
+	}
+
 	CItem::endRestore();
 
-	for (CItem* item : idToItem.values())
+	for (CItem* item : restoredItems)
 	{
 		item->onItemRestored();
 	}
@@ -777,7 +992,7 @@ void CEditorScene::del()
 void CEditorScene::copy()
 {
 	// store selected items only
-	QMap<CItem*, uint> sortedMap;
+	QMap<quint64, CItem*> sortedMap;
 
 	QList<QGraphicsItem*> allItems = copyPasteItems();
 
@@ -786,7 +1001,7 @@ void CEditorScene::copy()
 		CItem* citem = dynamic_cast<CItem*>(item);
 		if (citem)
 		{
-			sortedMap[citem] = quint64(citem);
+			sortedMap[citem->uid()] = citem;
 		}
 	}
 
@@ -802,39 +1017,20 @@ void CEditorScene::copy()
 
 	out << version64;
 
-	for (CItem* citem : sortedMap.keys())
+	for (CItem* citem : sortedMap)
 	{
-		out << citem->typeId() << quint64(citem);
+		out << citem->typeId() << citem->uid();
 
 		citem->storeTo(out, version64);
 	}
 
-	// create mime object
-	QMimeData* mimeData = new QMimeData;
-	mimeData->setData("qvge/selection", buffer);
-	QApplication::clipboard()->setMimeData(mimeData);
-
-	// paste it to a temp scene & render into mime image
-	CEditorScene* tempScene = createScene();
-	tempScene->copyProperties(*this);
-	tempScene->enableGrid(false);
-	tempScene->paste();
-	tempScene->deselectAll();
-	tempScene->crop();
-
-	QImage image(tempScene->sceneRect().size().toSize(), QImage::Format_ARGB32);
-	image.fill(Qt::white);
-
-	QPainter painter(&image);
-	painter.setRenderHint(QPainter::Antialiasing);
-	painter.setRenderHint(QPainter::TextAntialiasing);
-	tempScene->render(&painter);
-	painter.end();
-
-	mimeData->setImageData(QVariant(image));
-	QApplication::clipboard()->setMimeData(mimeData);
+	// compact form: marker + compressed stream
+	QByteArray selection;
+	QDataStream(&selection, QIODevice::WriteOnly) << s_selectionMarker;
+	selection += qCompress(buffer, 1);
 
-	delete tempScene;
+	// image will be rendered on demand
+	QApplication::clipboard()->setMimeData(new CSceneMimeData(*this, selection));
 }
 
 
@@ -879,8 +1075,20 @@ void CEditorScene::pasteAt(const QPointF &anchor)
 
 	deselectAll();
 
-	// read items from the buffer
-	QByteArray buffer = mimeData->data("qvge/selection");
+	pasteFrom(mimeData->data("qvge/selection"), anchor);
+}
+
+
+void CEditorScene::pasteFrom(const QByteArray& selection, const QPointF &anchor)
+{
+	// read items from the buffer (compressed or plain)
+	QByteArray buffer = selection;
+
+	quint32 marker = 0;
+	QDataStream(selection) >> marker;
+	if (marker == s_selectionMarker)
+		buffer = qUncompress(selection.mid(sizeof(marker)));
+
 	QDataStream out(buffer);
 
 	// version
@@ -930,12 +1138,6 @@ void CEditorScene::pasteAt(const QPointF &anchor)
 	if (lifeList.isEmpty())
 		return;
 
-	// shift & rename pasted items which were not removed
-	QMap<QString, int> ids;
-	auto allItems = getItems<CItem>();
-	for (auto item : allItems)
-		ids[item->getId() + item->typeId()]++;
-
 	// shift if not in-place
 	auto selItems = selectedItems();
 
@@ -946,20 +1148,29 @@ void CEditorScene::pasteAt(const QPointF &anchor)
 		moveSelectedItemsBy(d);
 	}
 
-	// rename pasted items
+	// rename pasted items which were not removed
+	auto countSameIds = [this](const QString& id, const QByteArray& typeId)
+	{
+		int count = 0;
+		for (auto item : getItemsById<CItem>(id))
+			if (item->typeId() == typeId)
+				count++;
+		return count;
+	};
+
 	for (auto sceneItem : selItems)
 	{
 		CItem* item = dynamic_cast<CItem*>(sceneItem);
 		if (item)
 		{
 			QString id = item->getId();
-			QString typeId = item->typeId();
-			if (ids[id + typeId] > 1)
+			QByteArray typeId = item->typeId();
+			if (countSameIds(id, typeId) > 1)
 			{
 				int counter = 1;
 				QString newId = id;
 
-				while (ids.contains(newId + typeId))
+				while (countSameIds(newId, typeId))
 					newId = QString("Copy%1 of %2").arg(counter++).arg(id);
 
 				item->setId(newId);
@@ -980,6 +1191,81 @@ void CEditorScene::pasteAt(const QPointF &anchor)
 }
 
 
+// clipboard data
+
+CSceneMimeData::CSceneMimeData(CEditorScene& scene, const QByteArray& selection):
+	m_scene(&scene)
+{
+	setData("qvge/selection", selection);
+}
+
+
+QStringList CSceneMimeData::formats() const
+{
+	QStringList result = QMimeData::formats();
+
+	// image is available while the scene is alive
+	if (m_scene || !m_image.isNull())
+		result << "application/x-qt-image" << "image/png";
+
+	return result;
+}
+
+
+QVariant CSceneMimeData::retrieveData(const QString &mimeType, QVariant::Type type) const
+{
+	if (mimeType == "application/x-qt-image")
+	{
+		const QImage& image = renderImage();
+		if (!image.isNull())
+			return image;
+	}
+
+	if (mimeType == "image/png")
+	{
+		const QImage& image = renderImage();
+		if (!image.isNull())
+		{
+			QByteArray data;
+			QBuffer buffer(&data);
+			buffer.open(QIODevice::WriteOnly);
+			image.save(&buffer, "PNG");
+			return data;
+		}
+	}
+
+	return QMimeData::retrieveData(mimeType, type);
+}
+
+
+const QImage& CSceneMimeData::renderImage() const
+{
+	if (!m_image.isNull() || !m_scene)
+		return m_image;
+
+	// paste the items to a temp scene & render it
+	CEditorScene* tempScene = m_scene->createScene();
+	tempScene->copyProperties(*m_scene);
+	tempScene->enableGrid(false);
+	tempScene->pasteFrom(data("qvge/selection"), QPointF());
+	tempScene->deselectAll();
+	tempScene->crop();
+
+	m_image = QImage(tempScene->sceneRect().size().toSize(), QImage::Format_ARGB32);
+	m_image.fill(Qt::white);
+
+	QPainter painter(&m_image);
+	painter.setRenderHint(QPainter::Antialiasing);
+	painter.setRenderHint(QPainter::TextAntialiasing);
+	tempScene->render(&painter);
+	painter.end();
+
+	delete tempScene;
+
+	return m_image;
+}
+
+
 QList<QGraphicsItem*> CEditorScene::copyPasteItems() const
 {
 	return selectedItems();
@@ -1095,6 +1381,68 @@ void CEditorScene::drawTransformRect(QPainter *painter)
 void CEditorScene::onItemDestroyed(CItem *citem)
 {
 	Q_ASSERT(citem);
+
+	onItemRemoved(citem);
+}
+
+
+void CEditorScene::onItemAdded(CItem *citem)
+{
+	Q_ASSERT(citem);
+
+	if (m_itemsRegistry.add(citem))
+	{
+		++m_revision;
+
+		m_itemsById.insert(citem->getId(), citem);
+		m_itemsByUid[citem->uid()] = citem;
+
+		if (m_undoManager)
+			m_undoManager->onItemAdded(citem);
+	}
+}
+
+
+void CEditorScene::onItemRemoved(CItem *citem)
+{
+	Q_ASSERT(citem);
+
+	if (m_itemsRegistry.remove(citem))
+	{
+		++m_revision;
+
+		m_itemsById.remove(citem->getId(), citem);
+
+		if (m_itemsByUid.value(citem->uid()) == citem)
+		{
+			m_itemsByUid.remove(citem->uid());
+			m_cachedStates.remove(citem->uid());
+		}
+
+		if (m_undoManager)
+			m_undoManager->onItemRemoved(citem);
+	}
+}
+
+
+void CEditorScene::onItemChanged(CItem *citem)
+{
+	Q_ASSERT(citem);
+
+	++m_revision;
+
+	if (m_undoManager && m_itemsRegistry.contains(citem))
+		m_undoManager->onItemChanged(citem);
+}
+
+
+void CEditorScene::onItemIdChanged(CItem *citem, const QString& oldId)
+{
+	Q_ASSERT(citem);
+
+	// only items which are already indexed
+	if (m_itemsById.remove(oldId, citem))
+		m_itemsById.insert(citem->getId(), citem);
 }
 
 
@@ -1108,6 +1456,8 @@ void CEditorScene::onSceneChanged()
 
 void CEditorScene::onSelectionChanged()
 {
+	++m_revision;
+
 	int selectionCount = selectedItems().size();
 	actions()->cutAction->setEnabled(selectionCount > 0);
 	actions()->copyAction->setEnabled(selectionCount > 0);
@@ -1124,24 +1474,33 @@ void CEditorScene::onFocusItemChanged(QGraphicsItem *newFocusItem, QGraphicsItem
 
 // drawing
 
-void CEditorScene::drawBackground(QPainter *painter, const QRectF &)
+void CEditorScene::drawBackground(QPainter *painter, const QRectF &r)
 {
 	// invalidate items if needed
 	if (m_needUpdateItems)
 	{
 		m_needUpdateItems = false;
-		auto citems = getItems<CItem>();
-		for (auto citem : citems)
+		for (auto citem : m_itemsRegistry)
 		{
 			citem->updateCachedItems();
 			citem->getSceneItem()->update();
 		}
 	}
 
-	// update layout if needed
-	if (m_labelsUpdate)
+	// update layout if needed, or if the painted area has not been laid out yet
+	QPaintDevice *device = painter->device();
+	QRectF paintedRect = painter->worldTransform().inverted().mapRect(QRectF(0, 0, device->width(), device->height()));
+
+	bool isLaidOut = (m_labelsRect.isNull() || m_labelsRect.contains(paintedRect));
+
+	if (!isLaidOut)
+	{
+		layoutItemLabels(paintedRect);
+	}
+	else if (m_labelsUpdate)
 	{
-		layoutItemLabels();
+		// the same area again: the parts of a rendering must get the same layout
+		layoutItemLabels(m_labelsRect, false);
 	}
 
 	// fill background
@@ -1156,24 +1515,33 @@ void CEditorScene::drawBackground(QPainter *painter, const QRectF &)
 	painter->drawRect(sceneRect());
 
 	// draw grid if needed
-	if (m_gridSize < 0 || !m_gridEnabled)
+	if (m_gridSize <= 0 || !m_gridEnabled)
 		return;
 
-	painter->setPen(m_gridPen);
+	// only the exposed part of the scene
+	QRectF rect = sceneRect() & r;
+	if (rect.isEmpty())
+		return;
 
-	QRectF rect = sceneRect();
+	// zoomed out: skip the lines which would be too dense to be seen
+	const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+	qreal step = m_gridSize;
+	while (step * lod < lod_grid_step)
+		step *= 2;
 
-	qreal left = int(rect.left()) - (int(rect.left()) % m_gridSize);
-	qreal top = int(rect.top()) - (int(rect.top()) % m_gridSize);
+	painter->setPen(m_gridPen);
 
-	QVarLengthArray<QLineF, 100> lines;
+	qreal left = std::floor(rect.left() / step) * step;
+	qreal top = std::floor(rect.top() / step) * step;
 
-	for (qreal x = left; x < rect.right(); x += m_gridSize)
-		lines.append(QLineF(x, rect.top(), x, rect.bottom()));
-	for (qreal y = top; y < rect.bottom(); y += m_gridSize)
-		lines.append(QLineF(rect.left(), y, rect.right(), y));
+	QVarLengthArray<QLineF, 256> lines;
 
-	//qDebug() << lines.size();
+	for (qreal x = left; x < rect.right(); x += step)
+		if (x >= rect.left())
+			lines.append(QLineF(x, rect.top(), x, rect.bottom()));
+	for (qreal y = top; y < rect.bottom(); y += step)
+		if (y >= rect.top())
+			lines.append(QLineF(rect.left(), y, rect.right(), y));
 
 	painter->drawLines(lines.data(), lines.size());
 }
@@ -1191,19 +1559,6 @@ void CEditorScene::drawForeground(QPainter *painter, const QRectF &r)
 }
 
 
-bool CEditorScene::checkLabelRegion(const QRectF &r)
-{
-	if (!r.isValid())
-		return false;
-
-	if (m_usedLabelsRegion.intersects(r))
-		return false;
-
-	m_usedLabelsRegion.addRect(r);
-	return true;
-}
-
-
 CEditorScene::LabelsPolicy CEditorScene::getLabelsPolicy() const
 {
 	int labelPolicy = getClassAttribute(class_scene, attr_labels_policy, false).defaultValue.toInt();
@@ -1217,33 +1572,53 @@ void CEditorScene::setLabelsPolicy(CEditorScene::LabelsPolicy v)
 }
 
 
+QRectF CEditorScene::getVisibleSceneRect() const
+{
+	QRectF visibleRect;
+
+	for (auto view : views())
+		visibleRect |= view->mapToScene(view->viewport()->rect()).boundingRect();
+
+	return visibleRect;
+}
+
+
 void CEditorScene::layoutItemLabels()
 {
-	// reset region
-	m_usedLabelsRegion = QPainterPath();
+	layoutItemLabels(getVisibleSceneRect());
+}
+
+
+void CEditorScene::layoutItemLabels(const QRectF& rect, bool withMargin)
+{
+	if (withMargin && !rect.isNull())
+		m_labelsRect = rect.adjusted(-rect.width() / 2, -rect.height() / 2, rect.width() / 2, rect.height() / 2);
+	else
+		m_labelsRect = rect;
+
+	// reset occupied area
+	m_usedLabelsGrid.clear();
 
-	QList<CItem*> allItems = getItems<CItem>();
+	const auto& allItems = m_itemsRegistry;
 
 	// get labeling policy
 	auto labelPolicy = getLabelsPolicy();
+	bool labelsOff = (!m_labelsEnabled || labelPolicy == AlwaysOff);
 
-	// hide all if disabled
-	if (!m_labelsEnabled || labelPolicy == AlwaysOff)
+	// labels of the items outside are not visible anyway: they will be laid out when shown
+	for (auto citem : allItems)
 	{
-		for (auto citem : allItems)
+		if (!m_labelsRect.isNull() && !m_labelsRect.intersects(citem->getSceneItem()->sceneBoundingRect()))
+			continue;
+
+		// hide all if disabled
+		if (labelsOff)
 		{
 			citem->showLabel(false);
+			continue;
 		}
 
-		return;
-	}
-
-	QElapsedTimer tm;
-	tm.start();
-
-	// else layout texts
-	for (auto citem : allItems)
-	{
+		// else layout texts
 		citem->updateLabelContent();
 		citem->updateLabelPosition();
 
@@ -1252,13 +1627,10 @@ void CEditorScene::layoutItemLabels()
 		else
 		{
 			QRectF labelRect = citem->getSceneLabelRect();
-			QRectF reducedRect(labelRect.topLeft() / 10, labelRect.size() / 10);
 
-			citem->showLabel(checkLabelRegion(reducedRect));
+			citem->showLabel(labelRect.isValid() && m_usedLabelsGrid.addIfFree(labelRect));
 		}
 	}
-
-	//qDebug() << "layout labels: " << tm.elapsed();
 }
 
 
@@ -1267,6 +1639,8 @@ void CEditorScene::needUpdate()
 	m_labelsUpdate = true;
 	m_needUpdateItems = true;
 
+	++m_revision;
+
 	update();
 }
 
@@ -2091,6 +2465,20 @@ void CEditorScene::selectItems(const QList<CItem*>& items, bool exclusive)
 }
 
 
+void CEditorScene::selectItems(const QList<QGraphicsItem*>& items, bool exclusive)
+{
+	beginSelection();
+
+	if (exclusive)
+		deselectAll();
+
+	for (auto item : items)
+		item->setSelected(true);
+
+	endSelection();
+}
+
+
 void CEditorScene::beginSelection()
 {
 	blockSignals(true);
@@ -13,15 +13,19 @@ It can be used freely, maintaining the information above.
 #include <QGraphicsScene>
 #include <QGraphicsRectItem>
 #include <QSet>
+#include <QHash>
 #include <QMenu>
 #include <QByteArrayList>
 
 #include "CAttribute.h"
+#include "CItemRegistry.h"
+#include "CSpatialGrid.h"
 
 
 class IUndoManager;
 class ISceneItemFactory;
 class IInteractive;
+class IProgressMonitor;
 class ISceneMenuController;
 
 class CItem;
@@ -54,10 +58,13 @@ public:
     CEditorScene(QObject *parent = NULL);
 	virtual ~CEditorScene();
 
+	typedef CItemRegistry<CItem, IRS_Scene> ItemsRegistry;
+
 	virtual void reset();
 	virtual void initialize();
 
-	virtual bool fromGraph(const Graph&)	{ return false; }
+	// monitor (if any) is called between the batches of created items, returns false to cancel
+	virtual bool fromGraph(const Graph&, IProgressMonitor* /*monitor*/ = nullptr)	{ return false; }
 	virtual bool toGraph(Graph&)			{ return false; }
 
 	// properties
@@ -76,6 +83,9 @@ public:
 	bool itemLabelsEnabled() const		{ return m_labelsEnabled; }
 	bool itemLabelsNeedUpdate() const	{ return m_labelsUpdate; }
 
+	// increased on every change of the items which affects their look
+	quint64 getRevision() const			{ return m_revision; }
+
 	enum LabelsPolicy {
 		Auto, AlwaysOn, AlwaysOff
 	};
@@ -92,11 +102,29 @@ public:
 	void revertUndoState();
 	// sets initial scene state
 	void setInitialState();
+	// memory budget of the undo history (0: unlimited), older steps are kept in journalPath
+	bool setUndoMemoryLimit(qint64 bytes, const QString& journalPath = QString());
 
 	// serialization 
 	virtual bool storeTo(QDataStream& out, bool storeOptions) const;
 	virtual bool restoreFrom(QDataStream& out, bool readOptions);
 
+	// version of the data written by storeTo()
+	static quint64 dataVersion();
+
+	// partial serialization (used by the undo manager);
+	// the state is cached until the item revision changes, so unchanged items are not serialized again
+	QByteArray storeItemState(const CItem& item) const;
+	QByteArray storeSceneState() const;
+	// restores the items by their uids: empty state means the item has to be removed;
+	// storedVersion is the data version the states were written with
+	bool restoreItemStates(const QMap<quint64, QByteArray>& itemStates, const QByteArray& sceneState = QByteArray(), bool readOptions = true,
+		quint64 storedVersion = dataVersion());
+	// brings the scene to the given states: only the items which differ are restored,
+	// the others (together with their selection) are kept as is.
+	// Items are compared with their cached states (see storeItemState()), not serialized again
+	bool restoreFromStates(const QMap<quint64, QByteArray>& itemStates, const QByteArray& sceneState, bool readOptions = true);
+
 	// item factories
 	template<class T>
 	bool registerItemFactory() {
@@ -161,6 +189,11 @@ public:
 	void setClassAttributeConstrains(const QByteArray& classId, const QByteArray& attrId, CAttributeConstrains* cptr);
 
 	// items
+	// all the CItems of the scene (iteration does not allocate)
+	const ItemsRegistry& getItemsRegistry() const { return m_itemsRegistry; }
+
+	CItem* getItemByUid(quint64 uid) const { return m_itemsByUid.value(uid); }
+
 	template<class T = CItem, class L = T>
 	QList<T*> getItems() const;
 
@@ -210,8 +243,14 @@ public:
 	}
 
 	// other
-	bool checkLabelRegion(const QRectF& r);
+	// lays out labels of the items within the visible part of the scene
 	void layoutItemLabels();
+	// lays out labels of the items within rect (null rect: all the items);
+	// withMargin adds some area around, so scrolling a bit does not need another layout.
+	// Must be called once for the whole area before rendering it by parts (i.e. by strips)
+	void layoutItemLabels(const QRectF& rect, bool withMargin = true);
+	// union of the areas shown by the views (null rect if there are no views)
+	QRectF getVisibleSceneRect() const;
 
 	void needUpdate();
 
@@ -226,6 +265,12 @@ public:
 	// callbacks
 	virtual void onItemDestroyed(CItem *citem);
 
+	// registries & id index maintenance (called by the items)
+	virtual void onItemAdded(CItem *citem);
+	virtual void onItemRemoved(CItem *citem);
+	void onItemIdChanged(CItem *citem, const QString& oldId);
+	void onItemChanged(CItem *citem);
+
 	// actions
 	QObject* getActions();
 	CEditorSceneActions* actions();
@@ -241,6 +286,7 @@ public Q_SLOTS:
 	void selectAll();
 	void deselectAll();
 	void selectItems(const QList<CItem*>& items, bool exclusive = true);
+	void selectItems(const QList<QGraphicsItem*>& items, bool exclusive = true);
 
 	void del();
 	void cut();
@@ -324,6 +370,13 @@ private:
 	void removeItems();
 	void checkUndoState();
 
+	// pastes items stored by copy()
+	void pasteFrom(const QByteArray& selection, const QPointF &anchor);
+	friend class CSceneMimeData;
+
+	bool storeAttributesTo(QDataStream& out, bool storeOptions) const;
+	bool restoreAttributesFrom(QDataStream& out, quint64 storedVersion, bool readOptions);
+
 protected:
 	QPointF m_leftClickPos;
 	QPointF m_mousePos;
@@ -347,6 +400,20 @@ private:
 	
 	QObject *m_actions = nullptr;
 
+	// registry of the items & id -> items index
+	ItemsRegistry m_itemsRegistry;
+	QMultiHash<QString, CItem*> m_itemsById;
+	QMap<quint64, CItem*> m_itemsByUid;
+
+	// last stored states of the items, valid while the item revision is the same
+	struct CachedState
+	{
+		quint64 revision;
+		QByteArray state;
+	};
+
+	mutable QHash<quint64, CachedState> m_cachedStates;
+
 	QMap<QByteArray, QByteArray> m_classToSuperIds;
 	ClassAttributesMap m_classAttributes;
     QMap<QByteArray, QSet<QByteArray>> m_classAttributesVis;
@@ -359,13 +426,16 @@ private:
 
 	bool m_needUpdateItems;
 
+	quint64 m_revision = 0;
+
 	QPointF m_pastePos;
 
 	// selector
 	QRectF m_transformRect;
 
 	// labels
-	QPainterPath m_usedLabelsRegion;
+	CSpatialGrid m_usedLabelsGrid;
+	QRectF m_labelsRect;	// laid out area, null if all the items
 	bool m_labelsEnabled, m_labelsUpdate;
 
 	bool m_isFontAntialiased = true;
@@ -428,8 +498,7 @@ QList<T*> CEditorScene::getItems() const
 {
 	QList<T*> result;
 
-	auto allItems = items();
-	for (auto item : allItems)
+	for (auto item : m_itemsRegistry)
 	{
 		T* titem = dynamic_cast<L*>(item);
 		if (titem)
@@ -445,12 +514,9 @@ QList<T*> CEditorScene::getItemsById(const QString& id) const
 {
 	QList<T*> res;
 
-	auto allItems = items();
-	for (auto item : allItems)
+	for (auto it = m_itemsById.constFind(id); it != m_itemsById.constEnd() && it.key() == id; ++it)
 	{
-		T* titem = dynamic_cast<T*>(item);
-
-		if (titem && titem->getId() == id)
+		if (T* titem = dynamic_cast<T*>(it.value()))
 			res << titem;
 	}
 
@@ -33,3 +33,10 @@ const QByteArray class_edge = QByteArrayLiteral("edge");
 const QByteArray attr_id = QByteArrayLiteral("id");
 const QByteArray attr_label = QByteArrayLiteral("label");
 const QByteArray attr_labels_policy = QByteArrayLiteral("labels.policy");
+
+
+// levels of detail (see QStyleOptionGraphicsItem::levelOfDetailFromTransform)
+const double lod_node_size = 4.0;	// nodes smaller than this (in pixels) are drawn as plain rects
+const double lod_edge_zoom = 0.5;	// below this zoom edges are drawn as hairlines without arrows
+const double lod_label_size = 5.0;	// labels lower than this (in pixels) are not drawn
+const double lod_grid_step = 8.0;	// grid lines closer than this (in pixels) are thinned out
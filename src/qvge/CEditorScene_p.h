@@ -1,7 +1,13 @@
 #pragma once
 
+#include <QMimeData>
+#include <QPointer>
+#include <QImage>
+
 #include "CTextLabelEdit.h"
 
+class CEditorScene;
+
 
 // pimpl for CEditorScene
 
@@ -10,3 +16,24 @@ struct CEditorScene_p
 	CTextLabelEdit m_labelEditor;
 };
 
+
+// clipboard data of copied items: the image is rendered only when some application asks for it
+
+class CSceneMimeData : public QMimeData
+{
+public:
+	CSceneMimeData(CEditorScene& scene, const QByteArray& selection);
+
+	// reimp
+	virtual QStringList formats() const;
+
+protected:
+	virtual QVariant retrieveData(const QString &mimeType, QVariant::Type type) const;
+
+private:
+	const QImage& renderImage() const;
+
+	QPointer<CEditorScene> m_scene;
+	mutable QImage m_image;
+};
+
@@ -29,8 +29,9 @@ CEditorView::CEditorView(QWidget *parent)
 	setDragMode(RubberBandDrag);
 
     setRenderHint(QPainter::Antialiasing);
-	setOptimizationFlags(DontSavePainterState);
-    setOptimizationFlags(DontAdjustForAntialiasing);
+	// indirect painting: the items are drawn by the scene (see CNodeEditorScene::drawItems).
+	// The flag is obsolete, but it is the only way to get QGraphicsScene::drawItems() called
+	setOptimizationFlags(DontSavePainterState | DontAdjustForAntialiasing | IndirectPainting);
 }
 
 
@@ -8,54 +8,276 @@ It can be used freely, maintaining the information above.
 */
 
 #include "CFileSerializerCSV.h"
-#include "CAttribute.h"
-#include "CNode.h"
-#include "CDirectEdge.h"
-#include "CGraphInterface.h"
-#include "CNodeEditorScene.h"
+#include "CEditorScene.h"
 
 #include <QFile>
 #include <QDebug>
-#include <QTextStream>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QThread>
+#include <QFuture>
+#include <QtConcurrent/QtConcurrentMap>
+
+
+// node ids met in the file, shared by the parsing threads:
+// split into shards to keep the lock contention low
+
+class CConcurrentIdMap
+{
+public:
+	// returns index of the id, assigns the next free one if the id is new
+	int insert(const QString& id)
+	{
+		Shard& shard = m_shards[qHash(id) % ShardCount];
+
+		QMutexLocker lock(&shard.mutex);
+
+		auto it = shard.ids.constFind(id);
+		if (it != shard.ids.constEnd())
+			return it.value();
+
+		int index = m_count.fetchAndAddRelaxed(1);
+		shard.ids.insert(id, index);
+		return index;
+	}
+
+	// ids by their indices (call when all the threads are done)
+	QVector<QString> toVector() const
+	{
+		QVector<QString> result(m_count.load());
+
+		for (const Shard& shard : m_shards)
+			for (auto it = shard.ids.constBegin(); it != shard.ids.constEnd(); ++it)
+				result[it.value()] = it.key();
+
+		return result;
+	}
+
+private:
+	enum { ShardCount = 64 };
+
+	struct Shard
+	{
+		QMutex mutex;
+		QHash<QString, int> ids;
+	};
+
+	Shard m_shards[ShardCount];
+	QAtomicInt m_count;
+};
+
+
+// edge - start node - end node
+struct CSVEdgeRow
+{
+	QString id;
+	int startNode;
+	int endNode;
+};
+
+
+// range of whole lines parsed by one thread
+struct CSVChunk
+{
+	const char* begin;
+	const char* end;
+	QVector<CSVEdgeRow> rows;
+};
+
+
+static void parseChunk(CSVChunk& chunk, char delimiter, CConcurrentIdMap& nodeIds)
+{
+	const char* ptr = chunk.begin;
+
+	while (ptr < chunk.end)
+	{
+		const char* lineEnd = (const char*) memchr(ptr, '\n', chunk.end - ptr);
+		if (!lineEnd)
+			lineEnd = chunk.end;
+
+		const char* next = lineEnd + 1;
+
+		if (lineEnd > ptr && lineEnd[-1] == '\r')
+			lineEnd--;
+
+		// first 3 non-empty fields
+		QString items[3];
+		int count = 0;
+
+		while (ptr < lineEnd && count < 3)
+		{
+			const char* fieldEnd = (const char*) memchr(ptr, delimiter, lineEnd - ptr);
+			if (!fieldEnd)
+				fieldEnd = lineEnd;
+
+			if (fieldEnd > ptr)
+				items[count++] = QString::fromLocal8Bit(ptr, int(fieldEnd - ptr));
+
+			ptr = fieldEnd + 1;
+		}
+
+		ptr = next;
+
+		if (count < 3)
+			continue;
+
+		chunk.rows.append({ items[0], nodeIds.insert(items[1]), nodeIds.insert(items[2]) });
+	}
+}
 
 
 // reimp
 
 bool CFileSerializerCSV::load(const QString& fileName, CEditorScene& scene, QString* lastError) const
 {
-    CNodeEditorScene* nodeScene = dynamic_cast<CNodeEditorScene*>(&scene);
-    if (nodeScene == nullptr)
-        return false;
+	Graph graphModel;
+
+	if (load(fileName, graphModel, lastError))
+		return scene.fromGraph(graphModel);
+	else
+		return false;
+}
+
 
+// graph model
+
+bool CFileSerializerCSV::load(const QString& fileName, Graph& graph, QString* lastError, IProgressMonitor* monitor) const
+{
 	QFile file(fileName);
 	if (!file.open(QIODevice::ReadOnly))
+	{
+		if (lastError)
+			*lastError = file.errorString();
+
 		return false;
+	}
+
+	// map the file if possible, read it else
+	const char* data = nullptr;
+	qint64 size = file.size();
+
+	QByteArray content;
+	uchar* mapped = size > 0 ? file.map(0, size) : nullptr;
+	if (mapped)
+	{
+		data = (const char*) mapped;
+	}
+	else
+	{
+		content = file.readAll();
+		data = content.constData();
+		size = content.size();
+	}
+
+	graph.clear();
+
+	// split into chunks at line ends, parse them in parallel
+	const qint64 minChunkSize = 1024 * 1024;
+	int chunkCount = qMax(1, QThread::idealThreadCount() * 4);
+	qint64 chunkSize = qMax(minChunkSize, size / chunkCount + 1);
+
+	QVector<CSVChunk> chunks;
+	const char* end = data + size;
+	for (const char* ptr = data; ptr < end; )
+	{
+		const char* chunkEnd = ptr + qMin(chunkSize, qint64(end - ptr));
+		if (chunkEnd < end)
+		{
+			const char* lineEnd = (const char*) memchr(chunkEnd, '\n', end - chunkEnd);
+			chunkEnd = lineEnd ? lineEnd + 1 : end;
+		}
+
+		chunks.append({ ptr, chunkEnd, QVector<CSVEdgeRow>() });
+		ptr = chunkEnd;
+	}
+
+	CConcurrentIdMap nodeIds;
+	char delimiter = m_delimiter;
 
-	// try to parse
-	scene.reset();
+	QFuture<void> parsing = QtConcurrent::map(chunks, [&](CSVChunk& chunk) {
+		parseChunk(chunk, delimiter, nodeIds);
+	});
 
-    CGraphInterface graph(*nodeScene);
+	// parsed chunks are reported while waiting
+	bool cancelled = false;
 
-    QTextStream ts(&file);
-    while (!ts.atEnd())
-    {
-        QString line = ts.readLine();
-        QStringList items = line.split(m_delimiter, QString::SkipEmptyParts);
-        if (items.size() < 3)
-            continue;
+	if (monitor)
+	{
+		while (!parsing.isFinished())
+		{
+			if (!cancelled && !monitor->onProgress(parsing.progressValue(), chunks.size()))
+			{
+				cancelled = true;
+				parsing.cancel();
+			}
 
-        // edge - start node - end node
-        /*auto edge =*/ graph.addEdge(items[0], items[1], items[2]);
-    }
+			QThread::msleep(20);
+		}
+	}
 
-    file.close();
+	parsing.waitForFinished();
 
-    // update scene rect
-    scene.setSceneRect(scene.itemsBoundingRect());
+	if (mapped)
+		file.unmap(mapped);
 
-    scene.addUndoState();
+	file.close();
+
+	if (cancelled)
+	{
+		if (lastError)
+			*lastError = QObject::tr("Cancelled");
+
+		return false;
+	}
+
+	// fill the model in the file order: the first edge with the same id wins,
+	// nodes go with their first edge
+	QVector<QString> nodeNames = nodeIds.toVector();
+	QVector<bool> nodeAdded(nodeNames.size(), false);
+
+	QSet<QString> edgeIds;
+
+	auto addNode = [&](int index) -> QByteArray
+	{
+		QByteArray id = nodeNames[index].toUtf8();
+
+		if (!nodeAdded[index])
+		{
+			nodeAdded[index] = true;
+
+			Node node;
+			node.id = id;
+			graph.nodes.append(node);
+		}
+
+		return id;
+	};
+
+	for (CSVChunk& chunk : chunks)
+	{
+		for (const CSVEdgeRow& row : chunk.rows)
+		{
+			if (edgeIds.contains(row.id))
+				continue;
+
+			edgeIds.insert(row.id);
+
+			Edge edge;
+			edge.id = row.id.toUtf8();
+			edge.startNodeId = addNode(row.startNode);
+			edge.endNodeId = addNode(row.endNode);
+			graph.edges.append(edge);
+		}
+
+		chunk.rows.clear();
+	}
+
+	if (monitor)
+		monitor->onProgress(chunks.size(), chunks.size());
 
 	// done
 	return true;
 }
-
@@ -11,12 +11,16 @@ It can be used freely, maintaining the information above.
 
 #include "IFileSerializer.h"
 
-class CNode;
+#include <qvgeio/CGraphBase.h>
+#include <qvgeio/IProgressMonitor.h>
 
 
 class CFileSerializerCSV : public IFileSerializer
 {
 public:
+	// reads the file into the graph model, without the scene (i.e. on a worker thread)
+	bool load(const QString& fileName, Graph& graph, QString* lastError = nullptr, IProgressMonitor* monitor = nullptr) const;
+
 	// reimp
 	virtual QString description() const {
         return "Comma Separated Values";
@@ -11,71 +11,179 @@ It can be used freely, maintaining the information above.
 #include "CNode.h"
 #include "CEdge.h"
 
+#include <qvgeio/CFormatDOT.h>
+
 #include <QFile>
 #include <QTextStream>
 #include <QFileInfo>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <functional>
+
+
+// records formatted by one thread at once
+static const int s_chunkSize = 4096;
+
+// chunks formatted before writing them (per thread)
+static const int s_windowChunks = 2;
+
+
+template<class Record>
+void CFileSerializerDOT::writeRecords(const QVector<Record>& records, const std::function<void(const QByteArray&)>& write) const
+{
+	const int windowSize = s_chunkSize * s_windowChunks * qMax(1, QThread::idealThreadCount());
+
+	std::function<QByteArray(const QPair<int, int>&)> formatChunk = [&](const QPair<int, int>& chunk) -> QByteArray
+	{
+		QString text;
+		QTextStream ts(&text);
+
+		for (int i = chunk.first; i < chunk.second; ++i)
+			doWriteRecord(ts, records.at(i));
+
+		ts.flush();
+		return text.toUtf8();
+	};
+
+	// window by window: formatted in parallel, then written in order
+	for (int windowStart = 0; windowStart < records.size(); windowStart += windowSize)
+	{
+		const int windowEnd = qMin(windowStart + windowSize, records.size());
+
+		QVector<QPair<int, int>> chunks;
+		for (int i = windowStart; i < windowEnd; i += s_chunkSize)
+			chunks.append(qMakePair(i, qMin(i + s_chunkSize, windowEnd)));
+
+		const QList<QByteArray> texts = QtConcurrent::blockingMapped<QList<QByteArray>>(chunks, formatChunk);
+
+		for (const auto& text : texts)
+			write(text);
+	}
+}
 
 
 // reimp
 
+bool CFileSerializerDOT::load(const QString& fileName, CEditorScene& scene, QString* lastError) const
+{
+	Graph graphModel;
+
+	if (CFormatDOT().load(fileName, graphModel, lastError))
+		return scene.fromGraph(graphModel);
+	else
+		return false;
+}
+
+
 bool CFileSerializerDOT::save(const QString& fileName, CEditorScene& scene, QString* lastError) const
 {
-	QFile saveFile(fileName);
-	if (saveFile.open(QFile::WriteOnly))
+	Document document;
+	capture(scene, fileName, document);
+
+	return save(fileName, document, lastError);
+}
+
+
+void CFileSerializerDOT::capture(const CEditorScene& scene, const QString& fileName, Document& document) const
+{
+	QVector<NodeRecord>& nodeRecords = document.nodes;
+	auto nodes = scene.getItems<CNode>();
+	nodeRecords.reserve(nodes.size());
+	for (auto node : nodes)
 	{
-        QTextStream ts(&saveFile);
+		nodeRecords.append({ node->getId(), node->pos(), node->getLocalAttributes() });
+	}
 
-        QString graphId = QFileInfo(fileName).completeBaseName();
+	QVector<EdgeRecord>& edgeRecords = document.edges;
+	auto edges = scene.getItems<CEdge>();
+	edgeRecords.reserve(edges.size());
+	for (auto edge : edges)
+	{
+		if (!edge->firstNode() || !edge->lastNode())
+			continue;
 
-        ts << "digraph \"" << graphId << "\"\n{";
-		ts << "\n\n";
+		edgeRecords.append({ edge->getId(),
+			edge->firstNode()->getId(), edge->lastNode()->getId(),
+			edge->firstPortId(), edge->lastPortId(),
+			edge->getLocalAttributes() });
+	}
 
-		// we'll output points, not inches
-		//ts << "\n\n";
-		//ts << "inputscale = 72;";
+	// header & defaults
+	QTextStream ts(&document.header);
 
-		// background
-		if (m_writeBackground)
-		{
-			ts << "bgcolor = \"" << scene.backgroundBrush().color().name() << "\"";
-			ts << "\n\n";
-		}
+	QString graphId = QFileInfo(fileName).completeBaseName();
 
-        // nodes
-		if (m_writeAttrs)
-		{
-			doWriteNodeDefaults(ts, scene);
-			ts << "\n\n";
-		}
+	ts << "digraph \"" << graphId << "\"\n{";
+	ts << "\n\n";
 
-        auto nodes = scene.getItems<CNode>();
-        for (auto node: nodes)
-        {
-			doWriteNode(ts, *node, scene);
-        }
+	// we'll output points, not inches (for neato & fdp which read inches by default)
+	ts << "inputscale = 72";
+	ts << "\n\n";
 
+	// background
+	if (m_writeBackground)
+	{
+		ts << "bgcolor = \"" << scene.backgroundBrush().color().name() << "\"";
 		ts << "\n\n";
+	}
 
+	ts.flush();
 
-        // edges
-		if (m_writeAttrs)
-		{
-			doWriteEdgeDefaults(ts, scene);
-			ts << "\n\n";
-		}
+	// nodes
+	if (m_writeAttrs)
+	{
+		QTextStream nts(&document.nodeDefaults);
+		doWriteNodeDefaults(nts, scene);
+		nts << "\n\n";
+	}
+
+	// edges
+	if (m_writeAttrs)
+	{
+		QTextStream ets(&document.edgeDefaults);
+		doWriteEdgeDefaults(ets, scene);
+		ets << "\n\n";
+	}
+}
 
-        auto edges = scene.getItems<CEdge>();
-        for (auto edge: edges)
-        {
-			doWriteEdge(ts, *edge, scene);
-        }
 
-		ts << "\n}\n";
+bool CFileSerializerDOT::save(const QString& fileName, const Document& document, QString* lastError) const
+{
+	QFile saveFile(fileName);
+	if (!saveFile.open(QFile::WriteOnly))
+	{
+		if (lastError)
+			*lastError = saveFile.errorString();
 
-		return true;
+		return false;
 	}
 
-	return false;
+	// records are formatted in parallel, then written sequentially by big blocks
+	bool ok = true;
+	std::function<void(const QByteArray&)> write = [&](const QByteArray& data)
+	{
+		if (ok && saveFile.write(data) != data.size())
+			ok = false;
+	};
+
+	write(document.header.toUtf8());
+	write(document.nodeDefaults.toUtf8());
+
+	writeRecords(document.nodes, write);
+
+	write("\n\n");
+
+	write(document.edgeDefaults.toUtf8());
+
+	writeRecords(document.edges, write);
+
+	write("\n}\n");
+
+	if (!ok && lastError)
+		*lastError = saveFile.errorString();
+
+	return ok;
 }
 
 
@@ -130,19 +238,17 @@ void CFileSerializerDOT::doWriteNodeDefaults(QTextStream& ts, const CEditorScene
 }
 
 
-void CFileSerializerDOT::doWriteNode(QTextStream& ts, const CNode& node, const CEditorScene& /*scene*/) const
+void CFileSerializerDOT::doWriteNode(QTextStream& ts, const NodeRecord& node) const
 {
-	ts << "\"" << node.getId() << "\"";
+	ts << "\"" << node.id << "\"";
 
 	if (m_writeAttrs)
 	{
 		ts << " [\n";
 
-		ts << "pos = \"" << node.pos().x() / 72.0 << "," << -node.pos().y() / 72.0 << "!\"\n";	//  / 72.0 -> point to inch; -y
+		ts << "pos = \"" << node.pos.x() << "," << -node.pos.y() << "!\"\n";	// points; -y
 
-		const QMap<QByteArray, QVariant>& nodeAttrs = node.getLocalAttributes();
-
-		doWriteNodeAttrs(ts, nodeAttrs);
+		doWriteNodeAttrs(ts, node.attrs);
 
 		ts << "]";
 	}
@@ -253,25 +359,23 @@ void CFileSerializerDOT::doWriteEdgeDefaults(QTextStream& ts, const CEditorScene
 }
 
 
-void CFileSerializerDOT::doWriteEdge(QTextStream& ts, const CEdge& edge, const CEditorScene& /*scene*/) const
+void CFileSerializerDOT::doWriteEdge(QTextStream& ts, const EdgeRecord& edge) const
 {
-	const auto& edgeAttrs = edge.getLocalAttributes();
-
-	ts << "\"" << edge.firstNode()->getId() << "\"";
-	if (edge.firstPortId().size())
-		ts << ":" << "\"" << edge.firstPortId() << "\"";
+	ts << "\"" << edge.firstNodeId << "\"";
+	if (edge.firstPortId.size())
+		ts << ":" << "\"" << edge.firstPortId << "\"";
 
 	ts << " -> ";
 
-	ts << "\"" << edge.lastNode()->getId() << "\"";
-	if (edge.lastPortId().size())
-		ts << ":" << "\"" << edge.lastPortId() << "\"";
+	ts << "\"" << edge.lastNodeId << "\"";
+	if (edge.lastPortId.size())
+		ts << ":" << "\"" << edge.lastPortId << "\"";
 
-	ts << " [id = \"" << edge.getId() << "\"\n";
+	ts << " [id = \"" << edge.id << "\"\n";
 
 	if (m_writeAttrs)
 	{
-		doWriteEdgeAttrs(ts, edgeAttrs);
+		doWriteEdgeAttrs(ts, edge.attrs);
 	}
 
 	ts << "];\n\n";
@@ -12,6 +12,10 @@ It can be used freely, maintaining the information above.
 #include <QMap>
 #include <QByteArray>
 #include <QVariant>
+#include <QPointF>
+#include <QVector>
+
+#include <functional>
 
 #include "qvge/IFileSerializer.h"
 
@@ -30,6 +34,34 @@ public:
 	{}
 
 
+	// scene data captured before formatting (which goes on worker threads)
+	struct NodeRecord
+	{
+		QString id;
+		QPointF pos;
+		QMap<QByteArray, QVariant> attrs;
+	};
+
+	struct EdgeRecord
+	{
+		QString id;
+		QString firstNodeId, lastNodeId;
+		QByteArray firstPortId, lastPortId;
+		QMap<QByteArray, QVariant> attrs;
+	};
+
+	// everything written to the file, so it can be written without the scene (i.e. on a worker thread)
+	struct Document
+	{
+		QString header, nodeDefaults, edgeDefaults;
+		QVector<NodeRecord> nodes;
+		QVector<EdgeRecord> edges;
+	};
+
+	void capture(const CEditorScene& scene, const QString& fileName, Document& document) const;
+
+	bool save(const QString& fileName, const Document& document, QString* lastError = nullptr) const;
+
 	// reimp
 	virtual QString description() const {
         return "DOT/GraphViz graph format";
@@ -44,12 +76,10 @@ public:
 	}
 
 	virtual bool loadSupported() const {
-        return false;
+		return true;
 	}
 
-    virtual bool load(const QString& /*fileName*/, CEditorScene& /*scene*/, QString* /*lastError = nullptr*/) const {
-        return false;
-    }
+	virtual bool load(const QString& fileName, CEditorScene& scene, QString* lastError = nullptr) const;
 
 	virtual bool saveSupported() const {
 		return true;
@@ -58,14 +88,22 @@ public:
 	virtual bool save(const QString& fileName, CEditorScene& scene, QString* lastError = nullptr) const;
 
 private:
+	// formats the records in parallel chunks and passes UTF-8 text of the chunks to write() in order;
+	// only a window of chunks is kept in memory at once
+	template<class Record>
+	void writeRecords(const QVector<Record>& records, const std::function<void(const QByteArray&)>& write) const;
+
 	void doWriteNodeDefaults(QTextStream& ts, const CEditorScene& scene) const;
-	void doWriteNode(QTextStream& ts, const CNode& node, const CEditorScene& scene) const;
+	void doWriteNode(QTextStream& ts, const NodeRecord& node) const;
 	void doWriteNodeAttrs(QTextStream& ts, QMap<QByteArray, QVariant> nodeAttrs) const;
 
 	void doWriteEdgeDefaults(QTextStream& ts, const CEditorScene& scene) const;
-	void doWriteEdge(QTextStream& ts, const CEdge& edge, const CEditorScene& scene) const;
+	void doWriteEdge(QTextStream& ts, const EdgeRecord& edge) const;
 	void doWriteEdgeAttrs(QTextStream& ts, QMap<QByteArray, QVariant> edgeAttrs) const;
 
+	void doWriteRecord(QTextStream& ts, const NodeRecord& node) const	{ doWriteNode(ts, node); }
+	void doWriteRecord(QTextStream& ts, const EdgeRecord& edge) const	{ doWriteEdge(ts, edge); }
+
 	bool m_writeBackground = true;
 	bool m_writeAttrs = true;
 };
@@ -8,107 +8,199 @@ It can be used freely, maintaining the information above.
 */
 
 #include "CFileSerializerGEXF.h"
-#include "CNode.h"
-#include "CDirectEdge.h"
+#include "CEditorScene.h"
+#include "CUtils.h"
 
 #include <QFile>
 #include <QDate>
 #include <QDebug>
 #include <QApplication>
-#include <QMessageBox>
+#include <QColor>
+#include <QTextStream>
+#include <QSizeF>
+
+
+// reads the children of the current element until its end:
+// handler returns true if it has read the child element up to its end itself
+
+template<class Handler>
+static void readChildren(QXmlStreamReader &xsr, Handler handler)
+{
+	int depth = 1;
+	while (depth > 0 && !xsr.atEnd())
+	{
+		auto token = xsr.readNext();
+
+		if (token == QXmlStreamReader::EndElement)
+			depth--;
+		else if (token == QXmlStreamReader::StartElement && !handler())
+			depth++;
+	}
+}
+
+
+// viz: attrs (v1.2), ns0: attrs (v1.1)
+
+static bool isVizElement(const QXmlStreamReader &xsr, const char* name)
+{
+	auto qname = xsr.qualifiedName();
+	if (!qname.endsWith(QLatin1String(name)) || qname.size() != int(qstrlen(name)) + 4)
+		return false;
+
+	return qname.startsWith(QLatin1String("viz:")) || qname.startsWith(QLatin1String("ns0:"));
+}
 
 
 // reimp
 
 bool CFileSerializerGEXF::load(const QString& fileName, CEditorScene& scene, QString* lastError) const
 {
-	// read file into document
-	QFile file(fileName);
-	if (!file.open(QIODevice::ReadOnly))
+	Graph graphModel;
+
+	if (load(fileName, graphModel, lastError))
+		return scene.fromGraph(graphModel);
+	else
 		return false;
-	
-	QString errorString;
-	int errorLine, errorColumn;
+}
 
-	QDomDocument doc("gexf");
-	if (!doc.setContent(&file, false, &errorString, &errorLine, &errorColumn))
-	{
-		file.close();
 
+bool CFileSerializerGEXF::save(const QString& fileName, CEditorScene& scene, QString* lastError) const
+{
+	Graph graphModel;
+
+	if (scene.toGraph(graphModel))
+		return save(fileName, graphModel, lastError);
+	else
+		return false;
+}
+
+
+// graph model
+
+bool CFileSerializerGEXF::load(const QString& fileName, Graph& graph, QString* lastError, IProgressMonitor* monitor) const
+{
+	// read file in one pass
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+	{
 		if (lastError)
-			*lastError = QObject::tr("%1\nline: %2, column: %3").arg(errorString).arg(errorLine).arg(errorColumn);
-			
+			*lastError = file.errorString();
+
 		return false;
 	}
-	
-	file.close();
 
-	// try to parse
-	scene.reset();
+	graph.clear();
 
     m_classIdMap.clear();
-    m_nodeMap.clear();
 
-	QDomNodeList graph = doc.elementsByTagName("graph");
-	if (graph.count())
-	{
-		m_edgeType = graph.at(0).toElement().attribute("defaultedgetype", "undirected");
-	}
+	m_edgeType = "undirected";
+	bool graphFound = false;
+
+	int nodeIndex = 0, edgeIndex = 0, attrsIndex = 0;
 
-    QDomNodeList attrs = doc.elementsByTagName("attributes");
-    for (int i = 0; i < attrs.count(); ++i)
-    {
-        readAttrs(i, attrs.at(i), scene);
-    }
+	const qint64 fileSize = file.size();
+	int elementCount = 0;
 
-    auto nodeIds = m_classIdMap["node"];
-	QDomNodeList nodes = doc.elementsByTagName("node");
-	for (int i = 0; i < nodes.count(); ++i)
+	QXmlStreamReader xsr(&file);
+
+	while (!xsr.atEnd())
 	{
-        readNode(i, nodes.at(i), nodeIds, scene);
+		if (xsr.readNext() != QXmlStreamReader::StartElement)
+			continue;
+
+		auto name = xsr.qualifiedName();
+
+		if (name == "node")
+		{
+			readNode(nodeIndex++, xsr, m_classIdMap["node"], graph);
+		}
+		else if (name == "edge")
+		{
+			readEdge(edgeIndex++, xsr, m_classIdMap["edge"], graph);
+		}
+		else if (name == "attributes")
+		{
+			readAttrs(attrsIndex++, xsr, graph);
+		}
+		else if (name == "graph" && !graphFound)
+		{
+			graphFound = true;
+
+			auto edgeType = xsr.attributes().value("defaultedgetype");
+			if (!edgeType.isEmpty())
+				m_edgeType = edgeType.toString();
+		}
+
+		// progress
+		if (monitor && (++elementCount % 1000) == 0)
+		{
+			if (!monitor->onProgress(file.pos(), fileSize))
+			{
+				graph.clear();
+
+				if (lastError)
+					*lastError = QObject::tr("Cancelled");
+
+				return false;
+			}
+		}
 	}
 
-    auto edgeIds = m_classIdMap["edge"];
-	QDomNodeList edges = doc.elementsByTagName("edge");
-	for (int i = 0; i < edges.count(); ++i)
+	if (xsr.hasError())
 	{
-        readEdge(i, edges.at(i), edgeIds, scene);
-	}
+		if (lastError)
+			*lastError = QObject::tr("%1\nline: %2, column: %3").arg(xsr.errorString()).arg(xsr.lineNumber()).arg(xsr.columnNumber());
+
+		graph.clear();
 
-    // update scene rect
-    scene.setSceneRect(scene.itemsBoundingRect());
+		return false;
+	}
 
-    scene.addUndoState();
+	if (monitor)
+		monitor->onProgress(fileSize, fileSize);
 
 	return true;
 }
 
 
-bool CFileSerializerGEXF::readAttrs(int /*index*/, const QDomNode &domNode, CEditorScene &scene) const
+bool CFileSerializerGEXF::readAttrs(int /*index*/, QXmlStreamReader &xsr, Graph& graph) const
 {
-    QDomElement elem = domNode.toElement();
-    QByteArray classId = elem.attribute("class", "").toLatin1();
+    QByteArray classId = xsr.attributes().value("class").toLatin1();
+
+	AttributeInfos& attrInfos =
+		(classId == "node") ? graph.nodeAttrs :
+		(classId == "edge") ? graph.edgeAttrs :
+		graph.graphAttrs;
+
+	readChildren(xsr, [&]() -> bool
+	{
+		if (xsr.qualifiedName() != "attribute")
+			return false;
+
+		QXmlStreamAttributes attrElem = xsr.attributes();
 
-	AttributesMap existingAttrs = scene.getClassAttributes(classId, true);
+		QString def;
+		readChildren(xsr, [&]() -> bool
+		{
+			if (xsr.qualifiedName() != "default")
+				return false;
 
-    auto attrs = elem.elementsByTagName("attribute");
-    for (int i = 0; i < attrs.count(); ++i)
-    {
-		QDomElement attrElem = attrs.at(i).toElement();
-        QByteArray id = attrElem.attribute("id", "").toLatin1();
+			if (def.isEmpty())
+				def = xsr.readElementText(QXmlStreamReader::IncludeChildElements);
+			else
+				xsr.skipCurrentElement();
+			return true;
+		});
+
+        QByteArray id = attrElem.value("id").toLatin1();
         if (id.isEmpty())
-            continue;
-        QByteArray attrId = attrElem.attribute("title", "").toLatin1();
+            return true;
+        QByteArray attrId = attrElem.value("title").toLatin1();
         if (attrId.isEmpty())
             attrId = id;
-        QByteArray type = attrElem.attribute("type", "").toLatin1();
+        QByteArray type = attrElem.value("type").toLatin1();
 
-        AttrInfo attrInfo = {attrId, 0};
-
-		QString def;
-		auto defs = attrElem.elementsByTagName("default");
-		if (defs.size())
-			def = defs.at(0).toElement().text();
+        KeyInfo attrInfo = {attrId, 0};
 
         if (type == "integer" || type == "long")
         {
@@ -131,259 +223,243 @@ bool CFileSerializerGEXF::readAttrs(int /*index*/, const QDomNode &domNode, CEdi
             attrInfo.variantType = QVariant::String;
         }
 
-
-		CAttribute attr = existingAttrs[attrId];
-		if (attr.id.isEmpty())
-		{	// no such attr
-			attr.id = attrId;
-			attr.classId = classId;
-			attr.userDefined = true;
-			attr.valueType = attrInfo.variantType;
+		// visibility attr
+		if (attrId == "_vis_")
+		{
+			auto visList = def.splitRef('|', QString::SkipEmptyParts);
+			for (auto& id : visList)
+				graph.visibleAttrs[classId].insert(id.toLatin1());
+			return true;
 		}
-		else // exist
-			attrInfo.variantType = attr.valueType;
 
+		AttrInfo attr;
+		attr.id = attrId;
+		attr.valueType = attrInfo.variantType;
 
 		if (def.size())
 		{
-			// visibility attr
-			if (attrId == "_vis_")
-			{
-				auto visList = def.splitRef('|');
-				for (auto& id : visList)
-					scene.setClassAttributeVisible(classId, id.toLatin1());
-				continue;
-			}
-
 			// stringlists
 			if (attrInfo.variantType == QVariant::StringList)
 			{
 				attr.defaultValue = def.split('|');
-				continue;
 			}
+			else
+			{
+				// other attrs
+				QVariant v = CUtils::textToVariant(def, attrInfo.variantType);
 
-			// other attrs
-			QVariant v = CUtils::textToVariant(def, attrInfo.variantType);
+				if (attrId == "size" && classId == "node")
+				{
+					v = QSizeF(v.toDouble(), v.toDouble());
+				}
 
-			if (attrId == "size" && classId == "node")
-			{
-				v = QSizeF(v.toDouble(), v.toDouble());
+				attr.defaultValue = v;
 			}
-
-			attr.defaultValue = v;
 		}
 
-		scene.setClassAttribute(classId, attr);
+		attrInfos[attrId] = attr;
 
         m_classIdMap[classId][id] = attrInfo;
-    }
+
+		return true;
+	});
 
     return true;
 }
 
 
-bool CFileSerializerGEXF::readNode(int index, const QDomNode &domNode, const IdToAttrMap &idMap, CEditorScene &scene) const
+bool CFileSerializerGEXF::readNode(int index, QXmlStreamReader &xsr, const IdToAttrMap &idMap, Graph& graph) const
 {
-	QDomElement elem = domNode.toElement();
+	Node node;
 
-	CNode* node = scene.createItemOfType<CNode>();
-	if (!node)
-		return false;
+	QXmlStreamAttributes elemAttrs = xsr.attributes();
 
 	// common attrs
-	QString id = elem.attribute("id", "");
-	node->setAttribute("id", id);
-
-	QString label = elem.attribute("label", "");
-	node->setAttribute("label", label);
-
-    // viz: attrs (v1.2), ns0: attrs (v1.1)
-    QDomNodeList viz_pos = elem.elementsByTagName("viz:position");  // v1.2
-    if (viz_pos.isEmpty())
-        viz_pos = elem.elementsByTagName("ns0:position");   // v1.1
-
-	if (viz_pos.size()) {
-		QDomElement viz_elem = viz_pos.at(0).toElement();
-		float x = viz_elem.attribute("x", "0").toFloat();
-		float y = viz_elem.attribute("y", "0").toFloat();
-		float z = viz_elem.attribute("z", QString(index)).toFloat();
-		node->setPos(x, y);
-		node->setZValue(z);
-	}
+	node.id = elemAttrs.value("id").toString().toUtf8();
 
-    QDomNodeList viz_color = elem.elementsByTagName("viz:color");   // v1.2
-    if (viz_color.isEmpty())
-        viz_color = elem.elementsByTagName("ns0:color");    // v1.1
-
-	if (viz_color.size()) {
-		QDomElement viz_elem = viz_color.at(0).toElement();
-		int r = viz_elem.attribute("r", "0").toInt();
-		int g = viz_elem.attribute("g", "0").toInt();
-		int b = viz_elem.attribute("b", "0").toInt();
-		QColor color(r, g, b);
-		node->setAttribute("color", color);
-	}
+	QString label = elemAttrs.value("label").toString();
+	node.attrs["label"] = label;
 
-    QDomNodeList viz_size = elem.elementsByTagName("viz:size");     // v1.2
-    if (viz_size.isEmpty())
-        viz_size = elem.elementsByTagName("ns0:size");      // v1.1
+	readChildren(xsr, [&]() -> bool
+	{
+		QXmlStreamAttributes vizAttrs = xsr.attributes();
 
-	if (viz_size.size()) {
-		QDomElement viz_elem = viz_size.at(0).toElement();
-		if (viz_elem.hasAttribute("value")) {
-			float v = viz_elem.attribute("value", "5").toFloat();
-			node->setAttribute("size", v);
-		}
-		else {
-			QSizeF sz = node->getSize();
-			if (viz_elem.hasAttribute("x"))
-				sz.setWidth(viz_elem.attribute("x").toFloat());
-			if (viz_elem.hasAttribute("y"))
-				sz.setHeight(viz_elem.attribute("y").toFloat());
-			node->setAttribute("size", sz);
+		if (isVizElement(xsr, "position"))
+		{
+			float x = vizAttrs.value("x").toFloat();
+			float y = vizAttrs.value("y").toFloat();
+			float z = vizAttrs.value("z").toFloat();
+			node.attrs["x"] = x;
+			node.attrs["y"] = y;
+			node.attrs["z"] = z;
+			return false;
 		}
-	}
-
-	// shape
-	QDomNodeList viz_shape = elem.elementsByTagName("viz:shape");   // v1.2
-	if (viz_shape.isEmpty())
-		viz_shape = elem.elementsByTagName("ns0:shape");    // v1.1
 
-	if (viz_shape.size()) {
-		QDomElement viz_elem = viz_shape.at(0).toElement();
-		QString v = viz_elem.attribute("value", "disc");
-		node->setAttribute("shape", v);
-	}
+		if (isVizElement(xsr, "color"))
+		{
+			int r = vizAttrs.value("r").toInt();
+			int g = vizAttrs.value("g").toInt();
+			int b = vizAttrs.value("b").toInt();
+			QColor color(r, g, b);
+			node.attrs["color"] = color;
+			return false;
+		}
 
-    // attrs
-    QDomNodeList attrs = elem.elementsByTagName("attvalue");
-    for (int i = 0; i < attrs.count(); ++i)
-    {
-        auto attrElem = attrs.at(i).toElement();
-        QByteArray attrId = attrElem.attribute("id", "").toLatin1();     // v1.2
-        if (attrId.isEmpty())
-            attrId = attrElem.attribute("for", "").toLatin1();           // v1.1
-        if (attrId.isEmpty())
-            continue;   // error: no id
-        if (!idMap.contains(attrId))
-            continue;      // error: not valid id
+		if (isVizElement(xsr, "size"))
+		{
+			if (vizAttrs.hasAttribute("value")) {
+				float v = vizAttrs.value("value").toFloat();
+				node.attrs["size"] = v;
+			}
+			else if (vizAttrs.hasAttribute("x") || vizAttrs.hasAttribute("y")) {
+				// the missing one is the same
+				float w = vizAttrs.value(vizAttrs.hasAttribute("x") ? "x" : "y").toFloat();
+				float h = vizAttrs.value(vizAttrs.hasAttribute("y") ? "y" : "x").toFloat();
+				node.attrs["size"] = QSizeF(w, h);
+			}
+			return false;
+		}
 
-        QVariant value = CUtils::textToVariant(attrElem.attribute("value"), idMap[attrId].variantType);
-        node->setAttribute(idMap[attrId].id, value);
-    }
+		// shape
+		if (isVizElement(xsr, "shape"))
+		{
+			QString v = vizAttrs.value("value").toString();
+			if (v.isEmpty())
+				v = "disc";
+			node.attrs["shape"] = v;
+			return false;
+		}
 
+		// attrs
+		if (xsr.qualifiedName() == "attvalue")
+		{
+			QByteArray attrId = vizAttrs.value("id").toLatin1();     // v1.2
+			if (attrId.isEmpty())
+				attrId = vizAttrs.value("for").toLatin1();           // v1.1
+			if (attrId.isEmpty())
+				return false;   // error: no id
+			if (!idMap.contains(attrId))
+				return false;      // error: not valid id
+
+			QVariant value = CUtils::textToVariant(vizAttrs.value("value").toString(), idMap[attrId].variantType);
+			node.attrs[idMap[attrId].id] = value;
+			return false;
+		}
 
-	scene.addItem(node);
+		// nested graphs are flattened
+		if (xsr.qualifiedName() == "node")
+		{
+			readNode(index, xsr, idMap, graph);
+			return true;
+		}
 
-	m_nodeMap[id] = node;
+		return false;
+	});
 
-	node->onItemRestored();
+	graph.nodes.append(node);
 
 	return true;
 }
 
 
-bool CFileSerializerGEXF::readEdge(int /*index*/, const QDomNode &domNode, const IdToAttrMap &idMap, CEditorScene& scene) const
+bool CFileSerializerGEXF::readEdge(int /*index*/, QXmlStreamReader &xsr, const IdToAttrMap &idMap, Graph& graph) const
 {
-	QDomElement elem = domNode.toElement();
+	Edge link;
 
-	auto* link = scene.createItemOfType<CDirectEdge>();
-	if (!link)
-		return false;
+	QXmlStreamAttributes elemAttrs = xsr.attributes();
 
 	// common attrs
-	QString id = elem.attribute("id", "");
-	link->setAttribute("id", id);
-
-	QString label = elem.attribute("label", "");
-	link->setAttribute("label", label);
+	link.id = elemAttrs.value("id").toString().toUtf8();
 
-	QString source = elem.attribute("source", "");
-	QString target = elem.attribute("target", "");
+	QString label = elemAttrs.value("label").toString();
+	link.attrs["label"] = label;
 
-	CNode* start = m_nodeMap[source];
-	CNode* last = m_nodeMap[target];
-	link->setFirstNode(start);
-	link->setLastNode(last);
+	link.startNodeId = elemAttrs.value("source").toString().toUtf8();
+	link.endNodeId = elemAttrs.value("target").toString().toUtf8();
 
 	// line
-	double weight = elem.attribute("weight", "-1").toDouble();
-	if (weight >= 0)
-		link->setAttribute("weight", weight);
+	if (elemAttrs.hasAttribute("weight"))
+	{
+		double weight = elemAttrs.value("weight").toDouble();
+		if (weight >= 0)
+			link.attrs["weight"] = weight;
+	}
 
 	// direction
-	QString edgeType = elem.attribute("edgetype", "");
+	QString edgeType = elemAttrs.value("edgetype").toString();
 	if (edgeType.isEmpty())
 		edgeType = m_edgeType;
 
-	link->setAttribute("direction", edgeType);
+	link.attrs["direction"] = edgeType;
 
-	// color
-	QDomNodeList viz_color = elem.elementsByTagName("viz:color");   // v1.2
-	if (viz_color.isEmpty())
-		viz_color = elem.elementsByTagName("ns0:color");    // v1.1
-
-	if (viz_color.size()) {
-		QDomElement viz_elem = viz_color.at(0).toElement();
-		int r = viz_elem.attribute("r", "0").toInt();
-		int g = viz_elem.attribute("g", "0").toInt();
-		int b = viz_elem.attribute("b", "0").toInt();
-		QColor color(r, g, b);
-		link->setAttribute("color", color);
-	}
-
-	// thickness
-	QDomNodeList viz_thickness = elem.elementsByTagName("viz:thickness");   // v1.2
-	if (viz_thickness.isEmpty())
-		viz_thickness = elem.elementsByTagName("ns0:thickness");    // v1.1
-
-	if (viz_thickness.size()) {
-		QDomElement viz_elem = viz_thickness.at(0).toElement();
-		float v = viz_elem.attribute("value", "1").toFloat();
-		link->setAttribute("thickness", v);
-	}
+	readChildren(xsr, [&]() -> bool
+	{
+		QXmlStreamAttributes vizAttrs = xsr.attributes();
 
-	// shape
-	QDomNodeList viz_shape = elem.elementsByTagName("viz:shape");   // v1.2
-	if (viz_shape.isEmpty())
-		viz_shape = elem.elementsByTagName("ns0:shape");    // v1.1
+		// color
+		if (isVizElement(xsr, "color"))
+		{
+			int r = vizAttrs.value("r").toInt();
+			int g = vizAttrs.value("g").toInt();
+			int b = vizAttrs.value("b").toInt();
+			QColor color(r, g, b);
+			link.attrs["color"] = color;
+			return false;
+		}
 
-	if (viz_shape.size()) {
-		QDomElement viz_elem = viz_shape.at(0).toElement();
-		QString v = viz_elem.attribute("value", "solid");
-		link->setAttribute("style", v);
-	}
+		// thickness
+		if (isVizElement(xsr, "thickness"))
+		{
+			float v = vizAttrs.hasAttribute("value") ? vizAttrs.value("value").toFloat() : 1;
+			link.attrs["thickness"] = v;
+			return false;
+		}
 
-    // attrs
-    QDomNodeList attrs = elem.elementsByTagName("attvalue");
-    for (int i = 0; i < attrs.count(); ++i)
-    {
-        auto attrElem = attrs.at(i).toElement();
-        QByteArray attrId = attrElem.attribute("id", "").toLatin1();     // v1.2
-        if (attrId.isEmpty())
-            attrId = attrElem.attribute("for", "").toLatin1();           // v1.1
-        if (attrId.isEmpty())
-            continue;   // error: no id
-        if (!idMap.contains(attrId))
-            continue;      // error: not valid id
+		// shape
+		if (isVizElement(xsr, "shape"))
+		{
+			QString v = vizAttrs.value("value").toString();
+			if (v.isEmpty())
+				v = "solid";
+			link.attrs["style"] = v;
+			return false;
+		}
 
-        QVariant value = CUtils::textToVariant(attrElem.attribute("value"), idMap[attrId].variantType);
-        link->setAttribute(idMap[attrId].id, value);
-    }
+		// attrs
+		if (xsr.qualifiedName() == "attvalue")
+		{
+			QByteArray attrId = vizAttrs.value("id").toLatin1();     // v1.2
+			if (attrId.isEmpty())
+				attrId = vizAttrs.value("for").toLatin1();           // v1.1
+			if (attrId.isEmpty())
+				return false;   // error: no id
+			if (!idMap.contains(attrId))
+				return false;      // error: not valid id
+
+			QVariant value = CUtils::textToVariant(vizAttrs.value("value").toString(), idMap[attrId].variantType);
+			link.attrs[idMap[attrId].id] = value;
+			return false;
+		}
 
-	scene.addItem(link);
+		return false;
+	});
 
-	link->onItemRestored();
+	graph.edges.append(link);
 
 	return true;
 }
 
 
-bool CFileSerializerGEXF::save(const QString& fileName, CEditorScene& scene, QString* /*lastError*/) const
+bool CFileSerializerGEXF::save(const QString& fileName, const Graph& graph, QString* lastError) const
 {
 	QFile file(fileName);
 	if (!file.open(QIODevice::WriteOnly))
+	{
+		if (lastError)
+			*lastError = file.errorString();
+
 		return false;
+	}
 
 	QTextStream ts(&file);
 	ts.setCodec("UTF-8");
@@ -399,32 +475,41 @@ bool CFileSerializerGEXF::save(const QString& fileName, CEditorScene& scene, QSt
 	ts << 
 		"    <meta lastmodifieddate = \"" << QDate::currentDate().toString(Qt::ISODate) << "\">\n"
 		"        <creator>" << QApplication::applicationDisplayName() << "</creator>\n"
-		"        <description>" << scene.getClassAttribute("", "comment", false).defaultValue.toString().toHtmlEscaped() << "</description>\n"
+		"        <description>" << graph.graphAttrs.value("comment").defaultValue.toString().toHtmlEscaped() << "</description>\n"
 		"    </meta>\n";
 
 	// graph
-	QString edgetype = scene.getClassAttribute("edge", "direction", false).defaultValue.toString();
-	//QString edgetype = scene.getClassAttribute<CEdge>("direction", false).defaultValue.toString();
+	QString edgetype = graph.edgeAttrs.value("direction").defaultValue.toString();
 	ts << "    <graph mode=\"static\" defaultedgetype=\"" << edgetype << "\">\n";
 
-	writeClassAttrs(ts, scene, "");
+	writeClassAttrs(ts, graph, "");
 
 	// node attrs
-	writeClassAttrs(ts, scene, "node");
+	writeClassAttrs(ts, graph, "node");
 
 	// edge attrs
-	writeClassAttrs(ts, scene, "edge");
+	writeClassAttrs(ts, graph, "edge");
 
 	// nodes
-	writeNodes(ts, scene);
+	writeNodes(ts, graph);
 
 	// edges
-	writeEdges(ts, scene);
+	writeEdges(ts, graph);
 
 	// footer
 	ts << "    </graph>\n";
 	ts << "</gexf>\n";
 
+	ts.flush();
+
+	if (ts.status() != QTextStream::Ok || file.error() != QFile::NoError)
+	{
+		if (lastError)
+			*lastError = file.errorString();
+
+		return false;
+	}
+
 	return true;
 }
 
@@ -461,37 +546,57 @@ static QString typeToString(int valueType)
 }
 
 
-void CFileSerializerGEXF::writeClassAttrs(QTextStream &ts, const CEditorScene& scene, const QByteArray &classId) const
+void CFileSerializerGEXF::writeClassAttrs(QTextStream &ts, const Graph& graph, const QByteArray &classId) const
 {
-	auto attrs = scene.getClassAttributes(classId, false);
+	AttributeInfos attrs =
+		(classId == "node") ? graph.nodeAttrs :
+		(classId == "edge") ? graph.edgeAttrs :
+		graph.graphAttrs;
 
-	// add local attributes if any
-	if (classId.size())
+	auto addLocalAttrs = [&](const GraphAttributes& itemAttrs)
 	{
-		auto items = (classId == "node") ? 
-			scene.getItems<CItem, CNode>(): 
-			scene.getItems<CItem, CEdge>();
-
-		for (auto item : items)
+		for (auto it = itemAttrs.constBegin(); it != itemAttrs.constEnd(); ++it)
 		{
-			auto itemAttrs = item->getLocalAttributes();
-			for (auto it = itemAttrs.constBegin(); it != itemAttrs.constEnd(); ++it)
+			auto id = it.key();
+			if (!attrs.contains(id))
 			{
-				auto id = it.key();
-				if (!attrs.contains(id))
-					attrs[id] = CAttribute(id);
+				AttrInfo attr;
+				attr.id = id;
+				attrs[id] = attr;
 			}
 		}
+	};
+
+	// add local attributes if any (positions go to viz:position)
+	if (classId == "node")
+	{
+		for (const auto& node : graph.nodes)
+		{
+			GraphAttributes nodeAttrs = node.attrs;
+			nodeAttrs.remove("x");
+			nodeAttrs.remove("y");
+			addLocalAttrs(nodeAttrs);
+		}
+	}
+	else if (classId == "edge")
+	{
+		for (const auto& edge : graph.edges)
+			addLocalAttrs(edge.attrs);
 	}
 
 	// add visible state if any
-	QSet<QByteArray> visSet = scene.getVisibleClassAttributes(classId, false);
+	QSet<QByteArray> visSet = graph.visibleAttrs.value(classId);
 	if (!visSet.isEmpty())
 	{
 		QStringList visList;
 		for (auto& id : visSet)
 			visList << id;
-		CAttribute visAttr("_vis_", "Visibility", visList);
+
+		AttrInfo visAttr;
+		visAttr.id = "_vis_";
+		visAttr.name = "Visibility";
+		visAttr.valueType = QMetaType::QStringList;
+		visAttr.defaultValue = visList;
 		attrs["_vis_"] = visAttr;
 	}
 
@@ -503,8 +608,6 @@ void CFileSerializerGEXF::writeClassAttrs(QTextStream &ts, const CEditorScene& s
 	for (auto it = attrs.constBegin(); it != attrs.constEnd(); ++it)
 	{
 		const auto &attr = it.value();
-		if (attr.isVirtual)
-			continue;
 
 		// size
 		if (it.key() == "size")
@@ -526,7 +629,7 @@ void CFileSerializerGEXF::writeClassAttrs(QTextStream &ts, const CEditorScene& s
 		// others (id = title)
 		ts << "        <attribute id=\"" << it.key() << "\" title=\"" << it.key() << "\" type=\"" << typeToString(attr.valueType) << "\">\n";
 		
-		if (!attr.noDefault && attr.defaultValue.isValid())
+		if (attr.defaultValue.isValid())
 		{
 			ts << "            <default>";
 
@@ -545,17 +648,18 @@ void CFileSerializerGEXF::writeClassAttrs(QTextStream &ts, const CEditorScene& s
 }
 
 
-void CFileSerializerGEXF::writeNodes(QTextStream &ts, const CEditorScene& scene) const
+void CFileSerializerGEXF::writeNodes(QTextStream &ts, const Graph& graph) const
 {
 	ts << "    <nodes>\n";
 
-	auto nodes = scene.getItems<CNode>();
-	for (const auto &node : nodes)
+	for (const auto &node : graph.nodes)
 	{
-		QMap<QByteArray, QVariant> nodeAttrs = node->getLocalAttributes();
+		QMap<QByteArray, QVariant> nodeAttrs = node.attrs;
+		double x = nodeAttrs.take("x").toDouble();
+		double y = nodeAttrs.take("y").toDouble();
 
-		ts << "        <node id=\"" << node->getId() << "\" label=\"" << nodeAttrs.take("label").toString().toHtmlEscaped() << "\">\n";
-		ts << "            <viz:position x=\"" << node->pos().x() << "\" y=\"" << node->pos().y() << "\"/>\n";
+		ts << "        <node id=\"" << QString::fromUtf8(node.id) << "\" label=\"" << nodeAttrs.take("label").toString().toHtmlEscaped() << "\">\n";
+		ts << "            <viz:position x=\"" << x << "\" y=\"" << y << "\"/>\n";
 
 		if (nodeAttrs.contains("size"))
 		{
@@ -593,17 +697,16 @@ void CFileSerializerGEXF::writeNodes(QTextStream &ts, const CEditorScene& scene)
 }
 
 
-void CFileSerializerGEXF::writeEdges(QTextStream &ts, const CEditorScene& scene) const
+void CFileSerializerGEXF::writeEdges(QTextStream &ts, const Graph& graph) const
 {
 	ts << "    <edges>\n";
 
-	auto edges = scene.getItems<CEdge>();
-	for (auto edge : edges)
+	for (const auto &edge : graph.edges)
 	{
-		QMap<QByteArray, QVariant> edgeAttrs = edge->getLocalAttributes();
+		QMap<QByteArray, QVariant> edgeAttrs = edge.attrs;
 
-		ts << "        <edge id=\"" << edge->getId() << "\" label=\"" << edgeAttrs.take("label").toString().toHtmlEscaped()
-			<< "\" source=\"" << edge->firstNode()->getId() << "\" target=\"" << edge->lastNode()->getId();
+		ts << "        <edge id=\"" << QString::fromUtf8(edge.id) << "\" label=\"" << edgeAttrs.take("label").toString().toHtmlEscaped()
+			<< "\" source=\"" << QString::fromUtf8(edge.startNodeId) << "\" target=\"" << QString::fromUtf8(edge.endNodeId);
 		
 		QString edgetype = edgeAttrs.take("direction").toString();
 		if (edgetype.size())
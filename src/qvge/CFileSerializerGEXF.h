@@ -11,17 +11,23 @@ It can be used freely, maintaining the information above.
 
 #include "IFileSerializer.h"
 
-#include <QtXml/QDomDocument>
 #include <QByteArray>
 #include <QMap>
 #include <QVariant>
+#include <QXmlStreamReader>
 
-class CNode;
+#include <qvgeio/CGraphBase.h>
+#include <qvgeio/IProgressMonitor.h>
 
 
 class CFileSerializerGEXF : public IFileSerializer 
 {
 public:
+	// reads the file into the graph model, without the scene (i.e. on a worker thread)
+	bool load(const QString& fileName, Graph& graph, QString* lastError = nullptr, IProgressMonitor* monitor = nullptr) const;
+
+	// writes the graph model taken from the scene, without the scene (i.e. on a worker thread)
+	bool save(const QString& fileName, const Graph& graph, QString* lastError = nullptr) const;
 
 	// reimp
 	virtual QString description() const {
@@ -49,23 +55,22 @@ public:
 	virtual bool save(const QString& fileName, CEditorScene& scene, QString* lastError = nullptr) const;
 
 private:
-    struct AttrInfo {
+    struct KeyInfo {
         QByteArray id;
         int variantType;
     };
-    typedef QMap<QByteArray, AttrInfo> IdToAttrMap;
+    typedef QMap<QByteArray, KeyInfo> IdToAttrMap;
     mutable QMap<QByteArray, IdToAttrMap> m_classIdMap;
 
-    bool readAttrs(int index, const QDomNode &domNode, CEditorScene& scene) const;
-    bool readNode(int index, const QDomNode &domNode, const IdToAttrMap &idMap, CEditorScene& scene) const;
-    bool readEdge(int index, const QDomNode &domNode, const IdToAttrMap &idMap, CEditorScene& scene) const;
-	void writeClassAttrs(QTextStream &ts, const CEditorScene& scene, const QByteArray &classId) const;
-	void writeNodes(QTextStream &ts, const CEditorScene& scene) const;
-	void writeEdges(QTextStream &ts, const CEditorScene& scene) const;
+	// the reader is positioned at the start element & leaves it at the end element
+    bool readAttrs(int index, QXmlStreamReader &xsr, Graph& graph) const;
+    bool readNode(int index, QXmlStreamReader &xsr, const IdToAttrMap &idMap, Graph& graph) const;
+    bool readEdge(int index, QXmlStreamReader &xsr, const IdToAttrMap &idMap, Graph& graph) const;
+	void writeClassAttrs(QTextStream &ts, const Graph& graph, const QByteArray &classId) const;
+	void writeNodes(QTextStream &ts, const Graph& graph) const;
+	void writeEdges(QTextStream &ts, const Graph& graph) const;
 	void writeAttValues(QTextStream &ts, const QMap<QByteArray, QVariant>& attvalues) const;
 
-	mutable QMap<QString, CNode*> m_nodeMap;
-
 	enum EdgeType {
 		Directed,
 		Undirected,
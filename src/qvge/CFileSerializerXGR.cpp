@@ -9,10 +9,21 @@ It can be used freely, maintaining the information above.
 
 #include "CFileSerializerXGR.h"
 #include "CEditorScene.h"
+#include "CNode.h"
+#include "CEdge.h"
 #include "ISceneItemFactory.h"
 
 #include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include <QtCore/QMap>
 #include <QtCore/QDataStream>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+#include <QtCore/QtEndian>
+#include <QtCore/QDateTime>
+
+#include <cstring>
+#include <algorithm>
 
 
 // static reader with DPSE format support
@@ -44,15 +55,212 @@ public:
 static CDPSERecoder s_dpseRecoder;
 
 
+// indexed format (revision 10)
+//
+// header | item data & strings | string table | node table | edge table | item table | scene state
+//
+// All the numbers are little endian. Records of the tables are fixed-width and point to
+// the item data (as written by CEditorScene::storeItemState()), so the file can be mapped
+// into memory and read without decoding the items: read() takes the types from the string table
+// and resolves the node indices of the edges (on a worker thread), restore() creates the items
+// from there. Positions & ids of the records serve the readers which do not decode the item data.
+
+static const char s_xgrMagic[8] = { 'Q', 'V', 'G', 'E', 'X', 'G', 'R', '\x1A' };
+static const quint32 s_xgrRevision = 10;
+static const quint32 s_noIndex = 0xFFFFFFFF;
+
+struct XGRHeader
+{
+	char magic[8];
+	quint32 revision;
+	quint32 headerSize;
+	quint64 dataVersion;
+	quint64 stringsOffset, stringsCount;
+	quint64 nodesOffset, nodesCount;
+	quint64 edgesOffset, edgesCount;
+	quint64 itemsOffset, itemsCount;
+	quint64 sceneOffset, sceneSize;
+	quint64 stamp;			// unique per written file, binds the journal (0 in the older headers)
+};
+
+// size of the header before the stamp was added
+static const quint32 s_xgrHeaderSizeV1 = 104;
+
+struct XGRString
+{
+	quint64 offset;
+	quint32 size;
+	quint32 reserved;
+};
+
+struct XGRNode
+{
+	quint64 uid;
+	quint32 typeId, id;		// string indices
+	quint64 x, y;			// double bits
+	quint64 dataOffset;
+	quint32 dataSize;
+	quint32 reserved;
+};
+
+struct XGREdge
+{
+	quint64 uid;
+	quint32 typeId, id;				// string indices
+	quint32 firstNode, lastNode;	// node indices
+	quint32 firstPort, lastPort;	// string indices
+	quint64 dataOffset;
+	quint32 dataSize;
+	quint32 reserved;
+};
+
+struct XGRItem
+{
+	quint64 uid;
+	quint32 typeId, id;		// string indices
+	quint64 dataOffset;
+	quint32 dataSize;
+	quint32 reserved;
+};
+
+static_assert(sizeof(XGRHeader) == 112, "XGR header layout");
+static_assert(sizeof(XGRString) == 16, "XGR string layout");
+static_assert(sizeof(XGRNode) == 48, "XGR node layout");
+static_assert(sizeof(XGREdge) == 48, "XGR edge layout");
+static_assert(sizeof(XGRItem) == 32, "XGR item layout");
+
+
+// journal: header | records...
+//
+// Records of a backup period are followed by a commit record; records after the last commit
+// (i.e. torn by a crash) are ignored. Journal is bound to the base file by the stamp of its header.
+
+static const char s_journalMagic[8] = { 'Q', 'V', 'G', 'E', 'X', 'G', 'R', 'J' };
+static const quint32 s_journalRevision = 2;
+
+enum XGRJournalRecordType
+{
+	JR_ItemState = 1,		// data: state of the item (created or changed)
+	JR_ItemRemoved = 2,		// no data
+	JR_SceneState = 3,		// data: scene attributes
+	JR_Commit = 4			// no data
+};
+
+struct XGRJournalHeader
+{
+	char magic[8];
+	quint32 revision;
+	quint32 headerSize;
+	quint64 dataVersion;
+	quint64 baseStamp;		// stamp of the base file
+};
+
+struct XGRJournalRecord
+{
+	quint32 type;
+	quint32 size;			// of the data following the record
+	quint64 uid;
+};
+
+static_assert(sizeof(XGRJournalHeader) == 32, "XGR journal header layout");
+static_assert(sizeof(XGRJournalRecord) == 16, "XGR journal record layout");
+
+
+template<class T>
+static inline T toLE(T v) { return qToLittleEndian(v); }
+
+template<class T>
+static inline T fromLE(T v) { return qFromLittleEndian(v); }
+
+static inline quint64 doubleToLE(double v)
+{
+	quint64 bits;
+	memcpy(&bits, &v, sizeof(bits));
+	return qToLittleEndian(bits);
+}
+
+static inline double doubleFromLE(quint64 bits)
+{
+	bits = qFromLittleEndian(bits);
+	double v;
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+
+// collects unique strings
+
+class CXGRStringTable
+{
+public:
+	quint32 index(const QByteArray& str)
+	{
+		auto it = m_indices.constFind(str);
+		if (it != m_indices.constEnd())
+			return it.value();
+
+		quint32 idx = m_strings.size();
+		m_strings.append(str);
+		m_indices[str] = idx;
+		return idx;
+	}
+
+	const QList<QByteArray>& strings() const { return m_strings; }
+
+private:
+	QHash<QByteArray, quint32> m_indices;
+	QList<QByteArray> m_strings;
+};
+
+
+// checks if a table fits into the file
+
+static bool checkRange(quint64 offset, quint64 count, quint64 recordSize, quint64 fileSize)
+{
+	if (offset > fileSize)
+		return false;
+
+	return count <= (fileSize - offset) / recordSize;
+}
+
+
+// reads the header of an indexed file; the part missing in the older headers is zeroed
+
+static bool readHeader(const uchar* data, quint64 size, XGRHeader& header)
+{
+	memset(&header, 0, sizeof(header));
+
+	if (size < s_xgrHeaderSizeV1)
+		return false;
+
+	memcpy(&header, data, s_xgrHeaderSizeV1);
+
+	const quint32 headerSize = fromLE(header.headerSize);
+	if (headerSize < s_xgrHeaderSizeV1 || headerSize > size)
+		return false;
+
+	memcpy(&header, data, qMin<quint64>(headerSize, sizeof(header)));
+	return true;
+}
+
+
 // reimp
 
 bool CFileSerializerXGR::load(const QString& fileName, CEditorScene& scene, QString* lastError) const
 {
+	// indexed format
+	if (isIndexed(fileName))
+	{
+		Snapshot snapshot;
+		return read(fileName, snapshot, lastError) && restore(snapshot, scene, lastError);
+	}
+
 	// read file into document
 	QFile openFile(fileName);
 	if (!openFile.open(QIODevice::ReadOnly))
 		return false;
 
+	// stream format
 	scene.reset();
 
     scene.setItemFactoryFilter(&s_dpseRecoder);
@@ -68,16 +276,800 @@ bool CFileSerializerXGR::load(const QString& fileName, CEditorScene& scene, QStr
 }
 
 
-bool CFileSerializerXGR::save(const QString& fileName, CEditorScene& scene, QString* lastError) const
+bool CFileSerializerXGR::isIndexed(const QString& fileName)
 {
-	QFile saveFile(fileName);
-	if (saveFile.open(QFile::WriteOnly))
+	QFile openFile(fileName);
+	if (!openFile.open(QIODevice::ReadOnly))
+		return false;
+
+	char magic[sizeof(s_xgrMagic)];
+	return openFile.read(magic, sizeof(magic)) == sizeof(magic) && memcmp(magic, s_xgrMagic, sizeof(magic)) == 0;
+}
+
+
+bool CFileSerializerXGR::read(const QString& fileName, Snapshot& snapshot, QString* lastError, IProgressMonitor* monitor) const
+{
+	QFile openFile(fileName);
+	if (!openFile.open(QIODevice::ReadOnly))
 	{
-		QDataStream ds(&saveFile);
-		scene.storeTo(ds, true);
+		if (lastError)
+			*lastError = openFile.errorString();
 
+		return false;
+	}
+
+	const quint64 fileSize = openFile.size();
+
+	// map the file (or read it if not possible)
+	QByteArray fileContent;
+	const uchar *base = openFile.map(0, fileSize);
+	if (base == nullptr)
+	{
+		fileContent = openFile.readAll();
+		base = (const uchar*)fileContent.constData();
+	}
+
+	auto fail = [&](const QString& error)
+	{
+		if (lastError)
+			*lastError = error;
+
+		if (fileContent.isEmpty())
+			openFile.unmap((uchar*)base);
+
+		snapshot = Snapshot();
+		return false;
+	};
+
+	// header
+	XGRHeader header;
+	if (!readHeader(base, fileSize, header) || memcmp(header.magic, s_xgrMagic, sizeof(s_xgrMagic)) != 0)
+		return fail(QObject::tr("File is truncated"));
+
+	if (fromLE(header.revision) != s_xgrRevision)
+		return fail(QObject::tr("Unsupported XGR revision: %1").arg(fromLE(header.revision)));
+
+	// older data are decoded by the items according to their version
+	const quint64 dataVersion = fromLE(header.dataVersion);
+	if (dataVersion == 0 || dataVersion > CEditorScene::dataVersion())
+		return fail(QObject::tr("Unsupported XGR data version: %1").arg(dataVersion));
+
+	const quint64 stringsOffset = fromLE(header.stringsOffset), stringsCount = fromLE(header.stringsCount);
+	const quint64 nodesOffset = fromLE(header.nodesOffset), nodesCount = fromLE(header.nodesCount);
+	const quint64 edgesOffset = fromLE(header.edgesOffset), edgesCount = fromLE(header.edgesCount);
+	const quint64 itemsOffset = fromLE(header.itemsOffset), itemsCount = fromLE(header.itemsCount);
+	const quint64 sceneOffset = fromLE(header.sceneOffset), sceneSize = fromLE(header.sceneSize);
+
+	if (!checkRange(stringsOffset, stringsCount, sizeof(XGRString), fileSize) ||
+		!checkRange(nodesOffset, nodesCount, sizeof(XGRNode), fileSize) ||
+		!checkRange(edgesOffset, edgesCount, sizeof(XGREdge), fileSize) ||
+		!checkRange(itemsOffset, itemsCount, sizeof(XGRItem), fileSize) ||
+		!checkRange(sceneOffset, sceneSize, 1, fileSize))
+		return fail(QObject::tr("File is corrupted"));
+
+	const XGRString *strings = (const XGRString*)(base + stringsOffset);
+
+	auto stringAt = [&](quint32 index, QByteArray& str)
+	{
+		if (index >= stringsCount)
+			return false;
+
+		XGRString record;
+		memcpy(&record, strings + index, sizeof(record));
+
+		const quint64 offset = fromLE(record.offset), size = fromLE(record.size);
+		if (!checkRange(offset, size, 1, fileSize))
+			return false;
+
+		str = QByteArray((const char*)base + offset, int(size));
+		return true;
+	};
+
+	// the item data are copied out of the mapping: the file is closed before the items are created
+	auto readItem = [&](ItemSnapshot& item, quint64 uid, quint32 typeIndex, quint32 idIndex, quint64 dataOffset, quint32 dataSize)
+	{
+		if (!stringAt(typeIndex, item.typeId) || !stringAt(idIndex, item.id) || !checkRange(dataOffset, dataSize, 1, fileSize))
+			return false;
+
+		item.uid = uid;
+		item.data = QByteArray((const char*)base + dataOffset, int(dataSize));
 		return true;
+	};
+
+	snapshot = Snapshot();
+	snapshot.dataVersion = dataVersion;
+	snapshot.sceneState = QByteArray((const char*)base + sceneOffset, int(sceneSize));
+	snapshot.items.reserve(int(nodesCount + edgesCount + itemsCount));
+
+	// records between the monitor calls
+	const quint64 batchSize = 4096;
+	const quint64 total = nodesCount + edgesCount + itemsCount;
+	quint64 done = 0;
+
+	auto nextItem = [&]()
+	{
+		return !monitor || (++done % batchSize) != 0 || monitor->onProgress(qint64(done), qint64(total));
+	};
+
+	// nodes: their uids by the indices to link the edges
+	QVector<quint64> nodeUids(int(nodesCount), 0);
+
+	const XGRNode *nodes = (const XGRNode*)(base + nodesOffset);
+	for (quint64 i = 0; i < nodesCount; ++i)
+	{
+		XGRNode record;
+		memcpy(&record, nodes + i, sizeof(record));
+
+		ItemSnapshot item;
+		item.kind = ItemSnapshot::Node;
+		item.x = doubleFromLE(record.x);
+		item.y = doubleFromLE(record.y);
+
+		if (!readItem(item, fromLE(record.uid), fromLE(record.typeId), fromLE(record.id), fromLE(record.dataOffset), fromLE(record.dataSize)))
+			return fail(QObject::tr("File is corrupted"));
+
+		nodeUids[int(i)] = item.uid;
+		snapshot.items.append(item);
+
+		if (!nextItem())
+			return fail(QObject::tr("Cancelled"));
+	}
+
+	const XGREdge *edges = (const XGREdge*)(base + edgesOffset);
+	for (quint64 i = 0; i < edgesCount; ++i)
+	{
+		XGREdge record;
+		memcpy(&record, edges + i, sizeof(record));
+
+		ItemSnapshot item;
+		item.kind = ItemSnapshot::Edge;
+
+		const quint32 firstNode = fromLE(record.firstNode), lastNode = fromLE(record.lastNode);
+		item.firstNode = firstNode < quint32(nodeUids.size()) ? nodeUids.at(firstNode) : 0;
+		item.lastNode = lastNode < quint32(nodeUids.size()) ? nodeUids.at(lastNode) : 0;
+
+		if (!readItem(item, fromLE(record.uid), fromLE(record.typeId), fromLE(record.id), fromLE(record.dataOffset), fromLE(record.dataSize))
+			|| !stringAt(fromLE(record.firstPort), item.firstPort) || !stringAt(fromLE(record.lastPort), item.lastPort))
+			return fail(QObject::tr("File is corrupted"));
+
+		snapshot.items.append(item);
+
+		if (!nextItem())
+			return fail(QObject::tr("Cancelled"));
+	}
+
+	const XGRItem *items = (const XGRItem*)(base + itemsOffset);
+	for (quint64 i = 0; i < itemsCount; ++i)
+	{
+		XGRItem record;
+		memcpy(&record, items + i, sizeof(record));
+
+		ItemSnapshot item;
+		if (!readItem(item, fromLE(record.uid), fromLE(record.typeId), fromLE(record.id), fromLE(record.dataOffset), fromLE(record.dataSize)))
+			return fail(QObject::tr("File is corrupted"));
+
+		snapshot.items.append(item);
+
+		if (!nextItem())
+			return fail(QObject::tr("Cancelled"));
+	}
+
+	if (fileContent.isEmpty())
+		openFile.unmap((uchar*)base);
+
+	std::sort(snapshot.items.begin(), snapshot.items.end(), [](const ItemSnapshot& a, const ItemSnapshot& b) {
+		return a.uid < b.uid;
+	});
+
+	// changes made after the file was written
+	readJournal(fileName, fromLE(header.stamp), snapshot.journal);
+
+	if (monitor)
+		monitor->onProgress(qint64(total), qint64(total));
+
+	return true;
+}
+
+
+bool CFileSerializerXGR::restore(const Snapshot& snapshot, CEditorScene& scene, QString* lastError, IProgressMonitor* monitor) const
+{
+	auto fail = [&](const QString& error)
+	{
+		if (lastError)
+			*lastError = error;
+
+		return false;
+	};
+
+	const quint64 dataVersion = snapshot.dataVersion ? snapshot.dataVersion : CEditorScene::dataVersion();
+
+	// scene attributes go first, the items depend on them
+	scene.reset();
+
+	if (!scene.restoreItemStates(QMap<quint64, QByteArray>(), snapshot.sceneState, true, dataVersion))
+		return fail(QObject::tr("Cannot restore the scene"));
+
+	// items are created by their types; their data start after the type & uid
+	QList<CItem*> restoredItems;
+
+	auto restoreItem = [&](const ItemSnapshot& itemSnapshot) -> CItem*
+	{
+		CItem* item = scene.createItemOfType(itemSnapshot.typeId);
+		if (item == nullptr)
+			return nullptr;
+
+		QDataStream in(itemSnapshot.data);
+		in.skipRawData(int(sizeof(quint32) + itemSnapshot.typeId.size() + sizeof(quint64)));
+
+		if (!item->restoreFrom(in, dataVersion))
+		{
+			delete item;
+			return nullptr;
+		}
+
+		item->setUid(itemSnapshot.uid);
+		scene.addItem(dynamic_cast<QGraphicsItem*>(item));
+
+		restoredItems << item;
+		return item;
+	};
+
+	// items created between the monitor calls
+	const int batchSize = 256;
+	const qint64 total = snapshot.items.size();
+	qint64 done = 0;
+	bool cancelled = false;
+
+	auto nextItem = [&]()
+	{
+		if (!cancelled && monitor && (++done % batchSize) == 0 && !monitor->onProgress(done, total))
+			cancelled = true;
+
+		return !cancelled;
+	};
+
+	bool ok = true;
+
+	CItem::beginRestore();
+
+	// nodes first, then the edges linked to them, then the others
+	QHash<quint64, CNode*> nodeItems;
+	nodeItems.reserve(snapshot.items.size());
+
+	for (const ItemSnapshot& itemSnapshot : snapshot.items)
+	{
+		if (itemSnapshot.kind != ItemSnapshot::Node)
+			continue;
+
+		if (!ok || !nextItem())
+			break;
+
+		CNode* node = dynamic_cast<CNode*>(restoreItem(itemSnapshot));
+		nodeItems[itemSnapshot.uid] = node;
+		ok = (node != nullptr);
+	}
+
+	for (const ItemSnapshot& itemSnapshot : snapshot.items)
+	{
+		if (itemSnapshot.kind != ItemSnapshot::Edge)
+			continue;
+
+		if (!ok || !nextItem())
+			break;
+
+		CItem* item = restoreItem(itemSnapshot);
+		ok = (item != nullptr);
+
+		if (CEdge* edgeItem = dynamic_cast<CEdge*>(item))
+		{
+			edgeItem->setFirstNode(nodeItems.value(itemSnapshot.firstNode), itemSnapshot.firstPort);
+			edgeItem->setLastNode(nodeItems.value(itemSnapshot.lastNode), itemSnapshot.lastPort);
+		}
+	}
+
+	// other items are linked the usual way
+	QList<CItem*> otherItems;
+
+	for (const ItemSnapshot& itemSnapshot : snapshot.items)
+	{
+		if (itemSnapshot.kind != ItemSnapshot::Item)
+			continue;
+
+		if (!ok || !nextItem())
+			break;
+
+		CItem* otherItem = restoreItem(itemSnapshot);
+		if (otherItem)
+			otherItems << otherItem;
+		else
+			ok = false;
+	}
+
+	if (ok && !cancelled && otherItems.size())
+	{
+		CItem::CItemLinkMap idToItem;
+		for (CItem* item : restoredItems)
+			idToItem[item->uid()] = item;
+
+		for (CItem* item : otherItems)
+			item->linkAfterRestore(idToItem);
+	}
+
+	CItem::endRestore();
+
+	if (cancelled)
+	{
+		scene.reset();
+		return fail(QObject::tr("Cancelled"));
+	}
+
+	for (CItem* item : restoredItems)
+		item->onItemRestored();
+
+	if (!ok)
+		return fail(QObject::tr("File is corrupted"));
+
+	// changes made after the file was written
+	const JournalChanges& journal = snapshot.journal;
+	if (journal.itemStates.size() || journal.sceneState.size())
+		scene.restoreItemStates(journal.itemStates, journal.sceneState, true, journal.dataVersion);
+
+    scene.addUndoState();
+
+	return true;
+}
+
+
+bool CFileSerializerXGR::readJournal(const QString& fileName, quint64 baseStamp, JournalChanges& journal) const
+{
+	journal = JournalChanges();
+
+	// files without the stamp cannot be bound
+	if (baseStamp == 0)
+		return true;
+
+	QFile journalFile(journalFileName(fileName));
+	if (!journalFile.open(QIODevice::ReadOnly))
+		return true;	// no journal
+
+	const QByteArray content = journalFile.readAll();
+	const char* data = content.constData();
+	const quint64 size = content.size();
+
+	// belongs to this file?
+	XGRJournalHeader header;
+	if (size < sizeof(header))
+		return false;
+
+	memcpy(&header, data, sizeof(header));
+
+	const quint64 dataVersion = fromLE(header.dataVersion);
+
+	if (memcmp(header.magic, s_journalMagic, sizeof(s_journalMagic)) != 0
+		|| fromLE(header.revision) != s_journalRevision
+		|| dataVersion == 0 || dataVersion > CEditorScene::dataVersion()
+		|| fromLE(header.baseStamp) != baseStamp)
+		return false;
+
+	// collect committed changes, the last ones win
+	QMap<quint64, QByteArray> itemStates, pendingStates;
+	QByteArray sceneState, pendingSceneState;
+
+	quint64 pos = fromLE(header.headerSize);
+	while (pos + sizeof(XGRJournalRecord) <= size)
+	{
+		XGRJournalRecord record;
+		memcpy(&record, data + pos, sizeof(record));
+		pos += sizeof(record);
+
+		const quint64 dataSize = fromLE(record.size);
+		if (pos + dataSize > size)
+			break;	// torn
+
+		QByteArray recordData(data + pos, int(dataSize));
+		pos += dataSize;
+
+		switch (fromLE(record.type))
+		{
+		case JR_ItemState:
+			pendingStates[fromLE(record.uid)] = recordData;
+			break;
+
+		case JR_ItemRemoved:
+			pendingStates[fromLE(record.uid)] = QByteArray();
+			break;
+
+		case JR_SceneState:
+			pendingSceneState = recordData;
+			break;
+
+		case JR_Commit:
+			for (auto it = pendingStates.constBegin(); it != pendingStates.constEnd(); ++it)
+				itemStates[it.key()] = it.value();
+			pendingStates.clear();
+
+			if (pendingSceneState.size())
+				sceneState = pendingSceneState;
+			pendingSceneState.clear();
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	journal.itemStates = itemStates;
+	journal.sceneState = sceneState;
+	journal.dataVersion = dataVersion;
+
+	return true;
+}
+
+
+bool CFileSerializerXGR::save(const QString& fileName, CEditorScene& scene, QString* lastError) const
+{
+	Snapshot snapshot;
+	takeSnapshot(scene, snapshot);
+
+	return save(fileName, snapshot, lastError);
+}
+
+
+void CFileSerializerXGR::takeSnapshot(const CEditorScene& scene, Snapshot& snapshot, const Snapshot* previous)
+{
+	// items sorted by uids
+	QMap<quint64, CItem*> sortedItems;
+	for (CItem* item : scene.getItemsRegistry())
+		sortedItems[item->uid()] = item;
+
+	QVector<ItemSnapshot> items;
+	items.reserve(sortedItems.size());
+
+	// previous snapshot is sorted as well: walk it along
+	int prevIndex = 0;
+	int prevCount = previous ? previous->items.size() : 0;
+
+	for (CItem* item : sortedItems)
+	{
+		ItemSnapshot itemSnapshot;
+		itemSnapshot.uid = item->uid();
+		itemSnapshot.revision = item->revision();
+		itemSnapshot.typeId = item->typeId();
+		itemSnapshot.id = item->getId().toUtf8();
+
+		if (CNode* node = dynamic_cast<CNode*>(item))
+		{
+			itemSnapshot.kind = ItemSnapshot::Node;
+			itemSnapshot.x = node->pos().x();
+			itemSnapshot.y = node->pos().y();
+		}
+		else if (CEdge* edge = dynamic_cast<CEdge*>(item))
+		{
+			itemSnapshot.kind = ItemSnapshot::Edge;
+			itemSnapshot.firstNode = edge->firstNode() ? edge->firstNode()->uid() : 0;
+			itemSnapshot.lastNode = edge->lastNode() ? edge->lastNode()->uid() : 0;
+			itemSnapshot.firstPort = edge->firstPortId();
+			itemSnapshot.lastPort = edge->lastPortId();
+		}
+
+		while (prevIndex < prevCount && previous->items.at(prevIndex).uid < itemSnapshot.uid)
+			prevIndex++;
+
+		if (prevIndex < prevCount
+			&& previous->items.at(prevIndex).uid == itemSnapshot.uid
+			&& previous->items.at(prevIndex).revision == itemSnapshot.revision)
+		{
+			itemSnapshot.data = previous->items.at(prevIndex).data;
+		}
+		else
+		{
+			itemSnapshot.data = scene.storeItemState(*item);
+		}
+
+		items.append(itemSnapshot);
+	}
+
+	snapshot.items = items;
+	snapshot.sceneState = scene.storeSceneState();
+}
+
+
+bool CFileSerializerXGR::save(const QString& fileName, const Snapshot& snapshot, QString* lastError) const
+{
+	QSaveFile saveFile(fileName);
+	if (!saveFile.open(QFile::WriteOnly))
+	{
+		if (lastError)
+			*lastError = saveFile.errorString();
+
+		return false;
+	}
+
+	bool ok = true;
+
+	auto write = [&](const void* data, qint64 size)
+	{
+		if (ok && saveFile.write((const char*)data, size) != size)
+			ok = false;
+	};
+
+	auto align = [&]()
+	{
+		static const char zeros[8] = { 0 };
+		qint64 pad = (8 - saveFile.pos() % 8) % 8;
+		write(zeros, pad);
+	};
+
+	// header placeholder
+	XGRHeader header;
+	memset(&header, 0, sizeof(header));
+	write(&header, sizeof(header));
+
+	CXGRStringTable strings;
+	QVector<XGRNode> nodeRecords;
+	QVector<XGREdge> edgeRecords;
+	QVector<XGRItem> itemRecords;
+	QHash<quint64, quint32> nodeIndices;
+
+	// item data: nodes first, so edges can refer them by index
+	for (const ItemSnapshot& item : snapshot.items)
+	{
+		if (item.kind != ItemSnapshot::Node)
+			continue;
+
+		XGRNode record;
+		record.uid = toLE(item.uid);
+		record.typeId = toLE(strings.index(item.typeId));
+		record.id = toLE(strings.index(item.id));
+		record.x = doubleToLE(item.x);
+		record.y = doubleToLE(item.y);
+		record.dataOffset = toLE(quint64(saveFile.pos()));
+		record.dataSize = toLE(quint32(item.data.size()));
+		record.reserved = 0;
+
+		write(item.data.constData(), item.data.size());
+
+		nodeIndices[item.uid] = nodeRecords.size();
+		nodeRecords.append(record);
+	}
+
+	for (const ItemSnapshot& item : snapshot.items)
+	{
+		if (item.kind == ItemSnapshot::Node)
+			continue;
+
+		quint64 dataOffset = saveFile.pos();
+
+		write(item.data.constData(), item.data.size());
+
+		if (item.kind == ItemSnapshot::Edge)
+		{
+			XGREdge record;
+			record.uid = toLE(item.uid);
+			record.typeId = toLE(strings.index(item.typeId));
+			record.id = toLE(strings.index(item.id));
+			record.firstNode = toLE(nodeIndices.value(item.firstNode, s_noIndex));
+			record.lastNode = toLE(nodeIndices.value(item.lastNode, s_noIndex));
+			record.firstPort = toLE(strings.index(item.firstPort));
+			record.lastPort = toLE(strings.index(item.lastPort));
+			record.dataOffset = toLE(dataOffset);
+			record.dataSize = toLE(quint32(item.data.size()));
+			record.reserved = 0;
+
+			edgeRecords.append(record);
+		}
+		else
+		{
+			XGRItem record;
+			record.uid = toLE(item.uid);
+			record.typeId = toLE(strings.index(item.typeId));
+			record.id = toLE(strings.index(item.id));
+			record.dataOffset = toLE(dataOffset);
+			record.dataSize = toLE(quint32(item.data.size()));
+			record.reserved = 0;
+
+			itemRecords.append(record);
+		}
+	}
+	// strings
+	QVector<XGRString> stringRecords;
+	for (const QByteArray& str : strings.strings())
+	{
+		XGRString record;
+		record.offset = toLE(quint64(saveFile.pos()));
+		record.size = toLE(quint32(str.size()));
+		record.reserved = 0;
+
+		write(str.constData(), str.size());
+
+		stringRecords.append(record);
+	}
+
+	// tables
+	align();
+	header.stringsOffset = toLE(quint64(saveFile.pos()));
+	header.stringsCount = toLE(quint64(stringRecords.size()));
+	write(stringRecords.constData(), stringRecords.size() * sizeof(XGRString));
+
+	header.nodesOffset = toLE(quint64(saveFile.pos()));
+	header.nodesCount = toLE(quint64(nodeRecords.size()));
+	write(nodeRecords.constData(), nodeRecords.size() * sizeof(XGRNode));
+
+	header.edgesOffset = toLE(quint64(saveFile.pos()));
+	header.edgesCount = toLE(quint64(edgeRecords.size()));
+	write(edgeRecords.constData(), edgeRecords.size() * sizeof(XGREdge));
+
+	header.itemsOffset = toLE(quint64(saveFile.pos()));
+	header.itemsCount = toLE(quint64(itemRecords.size()));
+	write(itemRecords.constData(), itemRecords.size() * sizeof(XGRItem));
+
+	// scene state
+	header.sceneOffset = toLE(quint64(saveFile.pos()));
+	header.sceneSize = toLE(quint64(snapshot.sceneState.size()));
+	write(snapshot.sceneState.constData(), snapshot.sceneState.size());
+
+	// final header
+	memcpy(header.magic, s_xgrMagic, sizeof(s_xgrMagic));
+	header.revision = toLE(s_xgrRevision);
+	header.headerSize = toLE(quint32(sizeof(header)));
+	header.dataVersion = toLE(CEditorScene::dataVersion());
+
+	// time & content: different for every write of the file
+	quint64 stamp = quint64(QDateTime::currentMSecsSinceEpoch())
+		^ (quint64(qHash(snapshot.sceneState)) << 32)
+		^ (quint64(snapshot.items.size()) << 16);
+	header.stamp = toLE(stamp ? stamp : 1);
+
+	if (ok && saveFile.seek(0))
+		write(&header, sizeof(header));
+	else
+		ok = false;
+
+	// replace the target file only when completely written
+	if (ok)
+		ok = saveFile.commit();
+	else
+		saveFile.cancelWriting();
+
+	// the journal of the old content is not valid anymore
+	if (ok)
+		QFile::remove(journalFileName(fileName));
+
+	if (!ok && lastError)
+		*lastError = saveFile.errorString();
+
+	return ok;
+}
+
+
+// journal
+
+QString CFileSerializerXGR::journalFileName(const QString& fileName)
+{
+	return fileName + ".journal";
+}
+
+
+bool CFileSerializerXGR::resetJournal(const QString& fileName, QString* lastError) const
+{
+	// stamp of the base file
+	XGRHeader baseHeader;
+	QFile baseFile(fileName);
+	QByteArray baseData = baseFile.open(QFile::ReadOnly) ? baseFile.read(sizeof(baseHeader)) : QByteArray();
+
+	if (!readHeader((const uchar*)baseData.constData(), baseData.size(), baseHeader) || baseHeader.stamp == 0)
+	{
+		if (lastError)
+			*lastError = QObject::tr("Journal base is not an indexed XGR file");
+
+		return false;
+	}
+
+	QSaveFile journalFile(journalFileName(fileName));
+	if (!journalFile.open(QFile::WriteOnly))
+	{
+		if (lastError)
+			*lastError = journalFile.errorString();
+
+		return false;
+	}
+
+	XGRJournalHeader header;
+	memcpy(header.magic, s_journalMagic, sizeof(s_journalMagic));
+	header.revision = toLE(s_journalRevision);
+	header.headerSize = toLE(quint32(sizeof(header)));
+	header.dataVersion = toLE(CEditorScene::dataVersion());
+	header.baseStamp = baseHeader.stamp;	// already little endian
+
+	bool ok = (journalFile.write((const char*)&header, sizeof(header)) == sizeof(header));
+
+	if (ok)
+		ok = journalFile.commit();
+	else
+		journalFile.cancelWriting();
+
+	if (!ok && lastError)
+		*lastError = journalFile.errorString();
+
+	return ok;
+}
+
+
+qint64 CFileSerializerXGR::appendJournal(const QString& fileName, const Snapshot& from, const Snapshot& to, QString* lastError) const
+{
+	QFile journalFile(journalFileName(fileName));
+	if (!journalFile.open(QFile::Append) || journalFile.size() < qint64(sizeof(XGRJournalHeader)))
+	{
+		if (lastError)
+			*lastError = journalFile.isOpen() ? QObject::tr("Journal is not initialized") : journalFile.errorString();
+
+		return -1;
+	}
+
+	// collect the records of this period in a buffer, so they go with one write
+	QByteArray buffer;
+
+	auto addRecord = [&](quint32 type, quint64 uid, const QByteArray& recordData)
+	{
+		XGRJournalRecord record;
+		record.type = toLE(type);
+		record.size = toLE(quint32(recordData.size()));
+		record.uid = toLE(uid);
+
+		buffer.append((const char*)&record, sizeof(record));
+		buffer.append(recordData);
+	};
+
+	// both are sorted by uids
+	int fromIndex = 0;
+	const int fromCount = from.items.size();
+
+	for (const ItemSnapshot& item : to.items)
+	{
+		// removed
+		while (fromIndex < fromCount && from.items.at(fromIndex).uid < item.uid)
+		{
+			addRecord(JR_ItemRemoved, from.items.at(fromIndex).uid, QByteArray());
+			fromIndex++;
+		}
+
+		// not changed
+		if (fromIndex < fromCount && from.items.at(fromIndex).uid == item.uid)
+		{
+			bool changed = (from.items.at(fromIndex).revision != item.revision);
+			fromIndex++;
+
+			if (!changed)
+				continue;
+		}
+
+		// created or changed
+		addRecord(JR_ItemState, item.uid, item.data);
+	}
+
+	for (; fromIndex < fromCount; fromIndex++)
+	{
+		addRecord(JR_ItemRemoved, from.items.at(fromIndex).uid, QByteArray());
+	}
+
+	if (to.sceneState != from.sceneState)
+	{
+		addRecord(JR_SceneState, 0, to.sceneState);
+	}
+
+	// nothing to add
+	if (buffer.isEmpty())
+		return journalFile.size();
+
+	addRecord(JR_Commit, 0, QByteArray());
+
+	if (journalFile.write(buffer) != buffer.size() || !journalFile.flush())
+	{
+		if (lastError)
+			*lastError = journalFile.errorString();
+
+		return -1;
 	}
 
-	return false;
+	return journalFile.size();
 }
@@ -10,15 +10,80 @@ It can be used freely, maintaining the information above.
 #pragma once
 
 #include <QtCore/QSettings>
+#include <QtCore/QFile>
+#include <QtCore/QVector>
+#include <QtCore/QByteArray>
+#include <QtCore/QMap>
 
 #include "qvge/IFileSerializer.h"
 
+#include <qvgeio/IProgressMonitor.h>
+
 
 class CNode;
 
 class CFileSerializerXGR : public IFileSerializer
 {
 public:
+	// stored data of an item as it goes into the file
+	struct ItemSnapshot
+	{
+		enum Kind { Item, Node, Edge };
+
+		quint64 uid = 0;
+		quint64 revision = 0;
+		int kind = Item;
+		QByteArray typeId, id;
+		QByteArray data;
+
+		double x = 0, y = 0;					// nodes
+		quint64 firstNode = 0, lastNode = 0;	// edges: uids of the nodes
+		QByteArray firstPort, lastPort;
+	};
+
+	// committed changes made after the file was written, as read from its journal
+	struct JournalChanges
+	{
+		QMap<quint64, QByteArray> itemStates;	// empty: removed item
+		QByteArray sceneState;
+		quint64 dataVersion = 0;
+	};
+
+	// immutable copy of the scene which can be written without the scene (i.e. on a worker thread)
+	struct Snapshot
+	{
+		QVector<ItemSnapshot> items;	// sorted by uids
+		QByteArray sceneState;
+
+		// read from a file only
+		quint64 dataVersion = 0;		// of the item data (0: the current one)
+		JournalChanges journal;
+	};
+
+	// takes a snapshot of the scene; data of the items not changed since the previous snapshot are shared with it
+	static void takeSnapshot(const CEditorScene& scene, Snapshot& snapshot, const Snapshot* previous = nullptr);
+
+	// writes the snapshot into a temporary file which replaces fileName on success
+	bool save(const QString& fileName, const Snapshot& snapshot, QString* lastError = nullptr) const;
+
+	// true for the files of the indexed format (the older stream format is read by load() only)
+	static bool isIndexed(const QString& fileName);
+
+	// reads an indexed file with its journal into the snapshot, without the scene (i.e. on a worker thread)
+	bool read(const QString& fileName, Snapshot& snapshot, QString* lastError = nullptr, IProgressMonitor* monitor = nullptr) const;
+
+	// creates the items of the snapshot read from a file in the scene
+	bool restore(const Snapshot& snapshot, CEditorScene& scene, QString* lastError = nullptr, IProgressMonitor* monitor = nullptr) const;
+
+	// append-only journal of the changes made after the file was saved, replayed by load()
+	static QString journalFileName(const QString& fileName);
+
+	// starts an empty journal bound to the saved fileName
+	bool resetJournal(const QString& fileName, QString* lastError = nullptr) const;
+
+	// appends changes between the snapshots to the journal of fileName; returns size of the journal or -1 on error
+	qint64 appendJournal(const QString& fileName, const Snapshot& from, const Snapshot& to, QString* lastError = nullptr) const;
+
 	// reimp
 	virtual QString description() const {
 		return "QVGE graph scene format";
@@ -43,5 +108,8 @@ public:
 	}
 
 	virtual bool save(const QString& fileName, CEditorScene& scene, QString* lastError = nullptr) const;
+
+private:
+	bool readJournal(const QString& fileName, quint64 baseStamp, JournalChanges& journal) const;
 };
 
@@ -115,31 +115,17 @@ bool CGraphInterface::setEdgeAttr(const QString& edgeId, const QByteArray& attrI
 
 QList<CEdge*> CGraphInterface::getEdges() const
 {
-    QList<CEdge*> edges;
-
     if (m_scene)
-    {
-        auto items = m_scene->items();
-        for (auto item: items)
-            if (auto edge = dynamic_cast<CEdge*>(item))
-                edges << edge;
-    }
+        return m_scene->getEdgesRegistry().toList();
 
-    return edges;
+    return QList<CEdge*>();
 }
 
 
 QList<CNode*> CGraphInterface::getNodes() const
 {
-    QList<CNode*> nodes;
-
     if (m_scene)
-    {
-        auto items = m_scene->items();
-        for (auto item: items)
-            if (auto node = dynamic_cast<CNode*>(item))
-                nodes << node;
-    }
+        return m_scene->getNodesRegistry().toList();
 
-    return nodes;
+    return QList<CNode*>();
 }
@@ -13,11 +13,20 @@ It can be used freely, maintaining the information above.
 #include <QMap>
 #include <QByteArray>
 #include <QSet>
+#include <QtEndian>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QGraphicsItem>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include "CImageExport.h"
 #include "CEditorScene.h"
 
 
+// max. size of a rendered strip (bytes)
+static const qint64 s_maxStripSize = 64 * 1024 * 1024;
+
+
 QString CImageExport::filters() const
 {
 	static QList<QByteArray> formats = QImageWriter::supportedImageFormats();
@@ -77,22 +86,229 @@ QString CImageExport::filters() const
 }
 
 
-bool CImageExport::save(const QString& fileName, CEditorScene& scene, QString* /*lastError*/) const
+bool CImageExport::save(const QString& fileName, CEditorScene& scene, QString* lastError) const
 {
-	CEditorScene* tempScene = scene.clone();
+	// cropped part of the scene (the scene itself is not touched)
+	QRectF sourceRect = scene.itemsBoundingRect().adjusted(-20, -20, 20, 20);
+
+	double scale = m_resolution / 96.0;
+	QSize imageSize = (sourceRect.size() * scale).toSize();
+	if (imageSize.isEmpty())
+		return false;
+
+	// selection is not exported
+	QList<QGraphicsItem*> selectedItems = scene.selectedItems();
+	scene.deselectAll();
+
+	// labels are laid out once for all the strips, else they could differ at the borders
+	scene.layoutItemLabels(sourceRect, false);
+
+	// formats which can be written by strips go without the whole image in memory
+	QByteArray format = QFileInfo(fileName).suffix().toLower().toLatin1();
 
-	tempScene->crop();
+	bool ok;
+	if (format == "ppm" || format == "bmp")
+		ok = saveStreamed(fileName, format, scene, sourceRect, imageSize, lastError);
+	else
+		ok = saveWhole(fileName, scene, sourceRect, imageSize, lastError);
 
-	QImage image(tempScene->sceneRect().size().toSize(), QImage::Format_ARGB32);
-	image.fill(Qt::white);
+	// one selectionChanged() for all the items
+	scene.selectItems(selectedItems);
+
+	return ok;
+}
+
+
+void CImageExport::renderStrip(CEditorScene& scene, const QRectF& sourceRect, int y, QImage& strip) const
+{
+	double scale = m_resolution / 96.0;
 
-	QPainter painter(&image);
+	strip.fill(Qt::white);
+
+	QRectF targetRect(0, 0, strip.width(), strip.height());
+	QRectF stripRect(sourceRect.left(), sourceRect.top() + y / scale, sourceRect.width(), strip.height() / scale);
+
+	QPainter painter(&strip);
 	painter.setRenderHint(QPainter::Antialiasing);
 	painter.setRenderHint(QPainter::TextAntialiasing);
-	tempScene->render(&painter);
+	scene.render(&painter, targetRect, stripRect, Qt::IgnoreAspectRatio);
 	painter.end();
+}
+
+
+bool CImageExport::saveWhole(const QString& fileName, CEditorScene& scene, const QRectF& sourceRect, const QSize& imageSize, QString* lastError) const
+{
+	QImage image(imageSize, QImage::Format_RGB32);
+	if (image.isNull())
+	{
+		if (lastError)
+			*lastError = QObject::tr("Image of %1x%2 pixels is too big, use BMP or PPM format").arg(imageSize.width()).arg(imageSize.height());
+
+		return false;
+	}
+
+	// render by strips into the image
+	int stripHeight = qBound<qint64>(1, s_maxStripSize / (imageSize.width() * 4), imageSize.height());
+
+	for (int y = 0; y < imageSize.height(); y += stripHeight)
+	{
+		int height = qMin(stripHeight, imageSize.height() - y);
+
+		QImage strip(image.scanLine(y), imageSize.width(), height, image.bytesPerLine(), QImage::Format_RGB32);
+		renderStrip(scene, sourceRect, y, strip);
+	}
+
+	int dotsPerMeter = qRound(m_resolution / 0.0254);
+	image.setDotsPerMeterX(dotsPerMeter);
+	image.setDotsPerMeterY(dotsPerMeter);
+
+	QImageWriter writer(fileName);
+	if (writer.write(image))
+		return true;
+
+	if (lastError)
+		*lastError = writer.errorString();
+
+	return false;
+}
+
+
+// rows of the strip as expected by the file: RGB (ppm) or BGR padded to 4 bytes (bmp)
+
+static QByteArray encodeStrip(const QImage& strip, bool bgr, int rowSize)
+{
+	QByteArray data(rowSize * strip.height(), 0);
+
+	for (int y = 0; y < strip.height(); ++y)
+	{
+		const QRgb* src = (const QRgb*)strip.constScanLine(y);
+		uchar* dst = (uchar*)data.data() + y * rowSize;
+
+		for (int x = 0; x < strip.width(); ++x, dst += 3)
+		{
+			QRgb pixel = src[x];
+			dst[0] = bgr ? qBlue(pixel) : qRed(pixel);
+			dst[1] = qGreen(pixel);
+			dst[2] = bgr ? qRed(pixel) : qBlue(pixel);
+		}
+	}
+
+	return data;
+}
+
+
+template<class T>
+static void putLE(QByteArray& header, int offset, T value)
+{
+	value = qToLittleEndian(value);
+	memcpy(header.data() + offset, &value, sizeof(value));
+}
+
+
+bool CImageExport::saveStreamed(const QString& fileName, const QByteArray& format, CEditorScene& scene, const QRectF& sourceRect, const QSize& imageSize, QString* lastError) const
+{
+	const bool isBMP = (format == "bmp");
+	const qint64 width = imageSize.width(), height = imageSize.height();
+
+	int rowSize = int(width * 3);
+	QByteArray header;
+
+	if (isBMP)
+	{
+		// 24 bit, top-down rows
+		rowSize = (rowSize + 3) & ~3;
+
+		const qint64 fileSize = 54 + rowSize * height;
+		if (fileSize > 0xFFFFFFFFLL)
+		{
+			if (lastError)
+				*lastError = QObject::tr("Image of %1x%2 pixels is too big for BMP, use PPM format").arg(width).arg(height);
+
+			return false;
+		}
+
+		const qint32 dotsPerMeter = qRound(m_resolution / 0.0254);
+
+		header.fill(0, 54);
+		header[0] = 'B';
+		header[1] = 'M';
+		putLE<quint32>(header, 2, quint32(fileSize));
+		putLE<quint32>(header, 10, 54);
+		putLE<quint32>(header, 14, 40);
+		putLE<qint32>(header, 18, qint32(width));
+		putLE<qint32>(header, 22, -qint32(height));
+		putLE<quint16>(header, 26, 1);
+		putLE<quint16>(header, 28, 24);
+		putLE<quint32>(header, 34, quint32(rowSize * height));
+		putLE<qint32>(header, 38, dotsPerMeter);
+		putLE<qint32>(header, 42, dotsPerMeter);
+	}
+	else
+	{
+		header = QString("P6\n%1 %2\n255\n").arg(width).arg(height).toLatin1();
+	}
+
+	QSaveFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly) || file.write(header) != header.size())
+	{
+		if (lastError)
+			*lastError = file.errorString();
+
+		return false;
+	}
+
+	// strips are rendered here (the scene is not thread-safe) while the previous one is encoded & written
+	// on a worker thread, so there are two strip buffers in turn
+	int stripHeight = qBound<qint64>(1, s_maxStripSize / (width * 4), height);
+
+	QImage strips[2] = {
+		QImage(int(width), stripHeight, QImage::Format_RGB32),
+		QImage(int(width), stripHeight, QImage::Format_RGB32)
+	};
+
+	if (strips[0].isNull() || strips[1].isNull())
+	{
+		if (lastError)
+			*lastError = QObject::tr("Not enough memory");
+
+		file.cancelWriting();
+		return false;
+	}
+
+	QFuture<bool> pending;
+	bool ok = true;
+	int index = 0;
+
+	for (int y = 0; y < height && ok; y += stripHeight, index ^= 1)
+	{
+		QImage& strip = strips[index];
+
+		int stripRows = int(qMin<qint64>(stripHeight, height - y));
+		if (stripRows < strip.height())
+			strip = strip.copy(0, 0, int(width), stripRows);
+
+		renderStrip(scene, sourceRect, y, strip);
+
+		if (pending.isStarted())
+			ok = pending.result();
+
+		pending = QtConcurrent::run([&file, &strip, isBMP, rowSize]() -> bool
+		{
+			QByteArray data = encodeStrip(strip, isBMP, rowSize);
+			return file.write(data) == data.size();
+		});
+	}
+
+	if (pending.isStarted())
+		ok = pending.result() && ok;
+
+	if (ok)
+		ok = file.commit();
+	else
+		file.cancelWriting();
 
-	delete tempScene;
+	if (!ok && lastError)
+		*lastError = file.errorString();
 
-	return image.save(fileName);
+	return ok;
 }
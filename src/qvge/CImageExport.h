@@ -10,13 +10,22 @@ It can be used freely, maintaining the information above.
 #pragma once
 
 #include <QString>
+#include <QRectF>
+#include <QSize>
 
 #include "qvge/IFileSerializer.h"
 
+class QImage;
+
 
 class CImageExport : public IFileSerializer
 {
 public:
+	// resolution: dots per inch of the image; the scene is assumed to be at 96 DPI
+	CImageExport(int resolution = 96) :
+		m_resolution(resolution)
+	{}
+
 	// reimp
 	virtual QString description() const {
 		return "Image Format";
@@ -41,4 +50,13 @@ public:
 	}
 
 	virtual bool save(const QString& fileName, CEditorScene& scene, QString* lastError = nullptr) const;
+
+private:
+	// renders the horizontal strip of the image starting at y
+	void renderStrip(CEditorScene& scene, const QRectF& sourceRect, int y, QImage& strip) const;
+
+	bool saveWhole(const QString& fileName, CEditorScene& scene, const QRectF& sourceRect, const QSize& imageSize, QString* lastError) const;
+	bool saveStreamed(const QString& fileName, const QByteArray& format, CEditorScene& scene, const QRectF& sourceRect, const QSize& imageSize, QString* lastError) const;
+
+	int m_resolution;
 };
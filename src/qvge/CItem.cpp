@@ -9,18 +9,39 @@ It can be used freely, maintaining the information above.
 
 
 #include "CItem.h"
+#include "CEditorSceneDefines.h"
 
 #include <QGraphicsSceneMouseEvent>
 #include <QMenu>
 
 
 bool CItem::s_duringRestore = false;
+quint64 CItem::s_lastUid = 0;
+quint64 CItem::s_lastRevision = 0;
+
+
+// CItemLabel
+
+void CItemLabel::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+	qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+	if (lod * boundingRect().height() < lod_label_size)
+		return;
+
+	QGraphicsSimpleTextItem::paint(painter, option, widget);
+}
+
+
+// CItem
 
 
 CItem::CItem()
 {
 	m_labelItem = NULL;
 
+	m_uid = ++s_lastUid;
+	m_revision = ++s_lastRevision;
+
 	// default item flags
 	m_itemFlags = IF_DeleteAllowed | IF_FramelessSelection;
 	m_internalStateFlags = IS_Attribute_Changed | IS_Need_Update;
@@ -55,6 +76,8 @@ bool CItem::storeTo(QDataStream &out, quint64 version64) const
 
 bool CItem::restoreFrom(QDataStream &out, quint64 version64)
 {
+	m_revision = ++s_lastRevision;
+
 	if (!out.atEnd())
 	{
 		if (version64 >= 2)
@@ -91,9 +114,20 @@ bool CItem::setAttribute(const QByteArray& attrId, const QVariant& v)
 {
 	setItemStateFlag(IS_Attribute_Changed);
 
+	notifyItemChanged();
+
 	if (attrId == "id")
 	{
+		QString oldId = m_id;
 		m_id = v.toString();
+
+		// keep scene's id index in sync
+		if (oldId != m_id)
+		{
+			if (auto scene = getScene())
+				scene->onItemIdChanged(this, oldId);
+		}
+
 		return true;
 	}
 
@@ -109,6 +143,7 @@ bool CItem::removeAttribute(const QByteArray& attrId)
 	if (m_attributes.remove(attrId))
 	{
 		setItemStateFlag(IS_Attribute_Changed);
+		notifyItemChanged();
 		return true;
 	}
 	else
@@ -150,6 +185,16 @@ QSet<QByteArray> CItem::getVisibleAttributeIds(int flags) const
 }
 
 
+void CItem::setUid(quint64 uid)
+{
+	m_uid = uid;
+
+	// new items must not reuse restored uids
+	if (uid > s_lastUid)
+		s_lastUid = uid;
+}
+
+
 bool CItem::setDefaultId()
 {
 	if (m_id.isEmpty())
@@ -180,6 +225,15 @@ void CItem::addUndoState()
 }
 
 
+void CItem::notifyItemChanged()
+{
+	m_revision = ++s_lastRevision;
+
+	if (auto scene = getScene())
+		scene->onItemChanged(this);
+}
+
+
 // cloning
 
 void CItem::copyDataFrom(CItem* from)
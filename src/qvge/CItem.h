@@ -44,6 +44,16 @@ enum ItemStateFlags
 class CControlPoint;
 
 
+// text label of an item: not painted while too small to be read
+class CItemLabel : public QGraphicsSimpleTextItem
+{
+public:
+	CItemLabel(QGraphicsItem *parent = Q_NULLPTR) : QGraphicsSimpleTextItem(parent) {}
+
+	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = Q_NULLPTR);
+};
+
+
 class Stub
 {
 public:
@@ -92,10 +102,19 @@ public:
 	QString getId() const { return m_id; }
 	void setId(const QString& id) { setAttribute("id", id); }
 
+	// persistent identity of the item (unique within the scene, kept by serialization)
+	quint64 uid() const { return m_uid; }
+	void setUid(quint64 uid);
+
+	// stamp of the last change of the stored data (unique among all the items)
+	quint64 revision() const { return m_revision; }
+
 	enum VisibleFlags { VF_ANY = 0, VF_LABEL = 1, VF_TOOLTIP = 2 };
 	virtual QSet<QByteArray> getVisibleAttributeIds(int flags) const;
 
 	// scene access
+	int& registrySlot(int slotId) { return m_registrySlots[slotId]; }
+
 	QGraphicsItem* getSceneItem() const {
 		return dynamic_cast<QGraphicsItem*>((CItem*)this);
 	}
@@ -104,6 +123,9 @@ public:
 
 	void addUndoState();
 
+	// informs the scene that stored data of the item were changed
+	void notifyItemChanged();
+
 	// labels
 	virtual void updateLabelContent();
 	virtual void updateLabelDecoration();
@@ -150,10 +172,18 @@ protected:
 	int m_internalStateFlags;
 	QMap<QByteArray, QVariant> m_attributes;
 	QString m_id;
+	quint64 m_uid;
+	quint64 m_revision;
 	QGraphicsSimpleTextItem *m_labelItem;
 
+	// positions in the scene registries
+	int m_registrySlots[IRS_Count] = { -1, -1 };
+
 	// restore optimization
 	static bool s_duringRestore;
+
+	static quint64 s_lastUid;
+	static quint64 s_lastRevision;
 };
 
 
@@ -167,16 +197,11 @@ QString CItem::createUniqueId(const QString& tmpl) const
 		return tmpl.arg(++count);
 	}
 
-	auto citems = editorScene->getItems<C>();
-	QSet<QString> ids;
-	for (const auto &citem : citems)
-		ids << citem->getId();
-
 	int count = 0;
 	QString newId;
 	do
 		newId = tmpl.arg(++count);
-	while (ids.contains(newId));
+	while (editorScene->getItemsById<C>(newId).size());
 
 	return newId;
 };
@@ -0,0 +1,99 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QVector>
+#include <QList>
+
+
+// slots of the registries an item can be put into at the same time
+enum ItemRegistrySlot
+{
+	IRS_Scene = 0,	// all the items of the scene
+	IRS_Kind = 1,	// items of the same kind (nodes, edges...)
+	IRS_Count
+};
+
+
+// Intrusive registry of scene items of some kind.
+// T must provide int& registrySlot(int slotId) which is used to keep position of the item
+// in the registry, so adding & removing are O(1) and iteration allocates nothing.
+// Order of the items is not preserved on removal.
+
+template<class T, int SlotId = 0>
+class CItemRegistry
+{
+public:
+	typedef typename QVector<T*>::const_iterator const_iterator;
+
+	const_iterator begin() const	{ return m_items.constBegin(); }
+	const_iterator end() const		{ return m_items.constEnd(); }
+
+	int size() const				{ return m_items.size(); }
+	bool isEmpty() const			{ return m_items.isEmpty(); }
+	T* at(int index) const			{ return m_items.at(index); }
+
+	bool contains(T* item) const
+	{
+		int slot = item->registrySlot(SlotId);
+		return slot >= 0 && slot < m_items.size() && m_items.at(slot) == item;
+	}
+
+	bool add(T* item)
+	{
+		if (contains(item))
+			return false;
+
+		item->registrySlot(SlotId) = m_items.size();
+		m_items.append(item);
+		return true;
+	}
+
+	bool remove(T* item)
+	{
+		if (!contains(item))
+			return false;
+
+		// move the last item into the freed slot
+		int slot = item->registrySlot(SlotId);
+		T* lastItem = m_items.last();
+		m_items[slot] = lastItem;
+		lastItem->registrySlot(SlotId) = slot;
+		m_items.removeLast();
+
+		item->registrySlot(SlotId) = -1;
+		return true;
+	}
+
+	void clear()
+	{
+		for (T* item : m_items)
+			item->registrySlot(SlotId) = -1;
+
+		m_items.clear();
+	}
+
+	// makes a copy of the items casted to L (when a real list is needed)
+	template<class L = T>
+	QList<L*> toList() const
+	{
+		QList<L*> result;
+		result.reserve(m_items.size());
+
+		for (T* item : m_items)
+			if (L* litem = dynamic_cast<L*>(item))
+				result.append(litem);
+
+		return result;
+	}
+
+private:
+	QVector<T*> m_items;
+};
@@ -1,6 +1,7 @@
 #include "CNode.h"
 #include "CEdge.h"
 #include "CDirectEdge.h"
+#include "CEditorSceneDefines.h"
 
 #include <QPen>
 #include <QBrush>
@@ -38,7 +39,7 @@ CNode::CNode(QGraphicsItem* parent) : QGraphicsRectItem(parent)
 	setCacheMode(DeviceCoordinateCache);
 
 	// label
-	m_labelItem = new QGraphicsSimpleTextItem(this);
+	m_labelItem = new CItemLabel(this);
 	m_labelItem->setFlags(0);
 	m_labelItem->setCacheMode(DeviceCoordinateCache);
 	m_labelItem->setPen(Qt::NoPen);
@@ -55,6 +56,10 @@ CNode::CNode(QGraphicsItem* parent) : QGraphicsRectItem(parent)
 
 CNode::~CNode()
 {
+	// scene item is still alive here (unlike in ~CItem)
+	if (auto editorScene = getScene())
+		editorScene->onItemDestroyed(this);
+
 	for (CNodePort *port : m_ports)
 	{
 		port->onParentDeleted();
@@ -187,6 +192,7 @@ bool CNode::setAttribute(const QByteArray& attrId, const QVariant& v)
 	if (attrId == "z")
 	{
 		setZValue(v.toDouble());
+		notifyItemChanged();
 		return true;
 	}
 
@@ -266,6 +272,8 @@ CNodePort* CNode::addPort(const QByteArray& portId, int align, double xoff, doub
 
 	updateCachedItems();
 
+	notifyItemChanged();
+
 	return port;
 }
 
@@ -283,6 +291,8 @@ bool CNode::removePort(const QByteArray& portId)
 
 	updateCachedItems();
 
+	notifyItemChanged();
+
 	return port;
 }
 
@@ -298,6 +308,8 @@ bool CNode::movePort(const QByteArray& portId, int align, double xoff, double yo
 
 	updatePortsLayout();
 
+	notifyItemChanged();
+
 	return true;
 }
 
@@ -320,6 +332,8 @@ bool CNode::renamePort(const QByteArray& portId, const QByteArray& newId)
 
 		updateCachedItems();
 
+		notifyItemChanged();
+
 		return true;
 	}
 
@@ -385,8 +399,15 @@ bool CNode::restoreFrom(QDataStream& out, quint64 version64)
 		qreal z; out >> z; setZValue(z);
 	}
 
-	// ports
+	// ports (drop existing ones if restoring in place)
+	QList<CNodePort*> oldPorts = m_ports.values();
 	m_ports.clear();
+	for (auto port : oldPorts)
+	{
+		port->onParentDeleted();
+		delete port;
+	}
+
 	if (version64 >= 11)
 	{
 		int count = 0; 
@@ -764,6 +785,15 @@ ItemDragTestResult CNode::acceptDragFromItem(QGraphicsItem* draggedItem)
 
 QVariant CNode::itemChange(QGraphicsItem::GraphicsItemChange change, const QVariant &value)
 {
+	if (change == ItemSceneChange)
+	{
+		// leave id index of the old scene
+		if (auto editorScene = getScene())
+			editorScene->onItemRemoved(this);
+
+		return value;
+	}
+
 	if (change == ItemSceneHasChanged)
 	{
 		// update attributes cache after attach to scene
@@ -772,6 +802,10 @@ QVariant CNode::itemChange(QGraphicsItem::GraphicsItemChange change, const QVari
 		// set default ID
 		setDefaultId();
 
+		// join id index of the new scene
+		if (auto editorScene = getScene())
+			editorScene->onItemAdded(this);
+
 		return value;
 	}
 
@@ -779,6 +813,8 @@ QVariant CNode::itemChange(QGraphicsItem::GraphicsItemChange change, const QVari
 	{
 		setItemStateFlag(IS_Attribute_Changed);
 
+		notifyItemChanged();
+
 		QPointF d = value.toPointF() - scenePos();
 		onItemMoved(d);
 
@@ -800,23 +836,33 @@ void CNode::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWi
 {
 	bool isSelected = (option->state & QStyle::State_Selected);
 
-	painter->setClipRect(boundingRect());
+	if (m_paintCache.revision != revision())
+		updatePaintCache();
+
+	const QColor& color = m_paintCache.color;
+	const QColor& strokeColor = m_paintCache.strokeColor;
+	const qreal strokeSize = m_paintCache.strokeSize;
+
+	// too small to be seen: plain rect only
+	QRectF shapeRect = Shape::boundingRect();
+	qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+	if (lod * qMax(shapeRect.width(), shapeRect.height()) < lod_node_size)
+	{
+		if (isSelected)
+			painter->fillRect(shapeRect, Qt::darkCyan);
+		else
+			painter->fillRect(shapeRect, color.isValid() ? color : strokeColor);
 
+		return;
+	}
+
+	painter->setClipRect(boundingRect());
 
-	// get color (to optimize!)
-	QColor color = getAttribute(QByteArrayLiteral("color")).value<QColor>();
 	if (color.isValid())
 		painter->setBrush(color);
 	else
 		painter->setBrush(Qt::NoBrush);
 
-	qreal strokeSize = getAttribute(QByteArrayLiteral("stroke.size")).toDouble();
-	strokeSize = qMax(0.1, strokeSize);
-
-	QColor strokeColor = getAttribute(QByteArrayLiteral("stroke.color")).value<QColor>();
-
-	int strokeStyle = CUtils::textToPenStyle(getAttribute(QByteArrayLiteral("stroke.style")).toString(), Qt::SolidLine);
-
 	// selection background outline
 	if (isSelected)
 	{
@@ -825,14 +871,9 @@ void CNode::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWi
 
 		// draw shape: disc if no cache
 		if (m_shapeCache.isEmpty())
-		{
-			QRectF r = Shape::boundingRect();
-			painter->drawEllipse(r);
-		}
+			painter->drawEllipse(shapeRect);
 		else
-		{
 			painter->drawPolygon(m_shapeCache);
-		}
 	}
 	
 	// hover opacity
@@ -841,18 +882,13 @@ void CNode::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWi
 	else
 		painter->setOpacity(1.0);
 
-	painter->setPen(QPen(strokeColor, strokeSize, (Qt::PenStyle)strokeStyle));
+	painter->setPen(QPen(strokeColor, strokeSize, m_paintCache.strokeStyle));
 
 	// draw shape: disc if no cache
 	if (m_shapeCache.isEmpty())
-	{
-		QRectF r = Shape::boundingRect();
-		painter->drawEllipse(r);
-	}
+		painter->drawEllipse(shapeRect);
 	else
-	{
 		painter->drawPolygon(m_shapeCache);
-	}
 }
 
 
@@ -867,6 +903,9 @@ QRectF CNode::boundingRect() const
 
 void CNode::updateCachedItems()
 {
+	// attributes of the class could be changed as well
+	m_paintCache.revision = 0;
+
 	auto shapeCache = m_shapeCache;
 	auto sizeCache = m_sizeCache;
 
@@ -923,6 +962,17 @@ void CNode::updateLabelPosition()
 
 // priv
 
+void CNode::updatePaintCache()
+{
+	m_paintCache.revision = revision();
+
+	m_paintCache.color = getAttribute(QByteArrayLiteral("color")).value<QColor>();
+	m_paintCache.strokeColor = getAttribute(QByteArrayLiteral("stroke.color")).value<QColor>();
+	m_paintCache.strokeSize = qMax(0.1, getAttribute(QByteArrayLiteral("stroke.size")).toDouble());
+	m_paintCache.strokeStyle = (Qt::PenStyle) CUtils::textToPenStyle(getAttribute(QByteArrayLiteral("stroke.style")).toString(), Qt::SolidLine);
+}
+
+
 void CNode::recalculateShape()
 {
 	QSizeF sz = getAttribute("size").toSizeF();
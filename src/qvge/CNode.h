@@ -70,6 +70,7 @@ public:
 	bool renamePort(const QByteArray& portId, const QByteArray& newId);
 	CNodePort* getPort(const QByteArray& portId) const;
 	QByteArrayList getPortIds() const;
+	const QMap<QByteArray, CNodePort*>& getPorts() const { return m_ports; }
 
 	// serialization 
 	virtual bool storeTo(QDataStream& out, quint64 version64) const;
@@ -137,6 +138,7 @@ protected:
 private:
 	void recalculateShape();
 	void updateConnections();
+	void updatePaintCache();
 
 protected:
 	QSet<CEdge*> m_connections;
@@ -146,6 +148,18 @@ protected:
 
 	QPolygonF m_shapeCache;
 	QRectF m_sizeCache;
+
+	// attributes used by paint(), taken again when the item or its class has been changed
+	struct PaintCache
+	{
+		quint64 revision = 0;
+		QColor color;
+		QColor strokeColor;
+		qreal strokeSize = 1;
+		Qt::PenStyle strokeStyle = Qt::SolidLine;
+	};
+
+	PaintCache m_paintCache;
 };
 
 
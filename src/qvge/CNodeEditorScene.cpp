@@ -9,6 +9,7 @@
 #include "CEditorSceneDefines.h"
 
 #include <qvgeio/CGraphBase.h>
+#include <qvgeio/IProgressMonitor.h>
 
 #include <QGraphicsSceneMouseEvent>
 #include <QColorDialog> 
@@ -16,6 +17,7 @@
 #include <QApplication>
 #include <QDebug>
 #include <QElapsedTimer>
+#include <QTimer>
 
 
 CNodeEditorScene::CNodeEditorScene(QObject *parent) : Super(parent),
@@ -42,31 +44,58 @@ CNodeEditorScene::CNodeEditorScene(QObject *parent) : Super(parent),
 }
 
 
-bool CNodeEditorScene::fromGraph(const Graph& g)
+bool CNodeEditorScene::fromGraph(const Graph& g, IProgressMonitor* monitor)
 {
 	reset();
 
-	
-	for (const auto& attr : g.graphAttrs)
+	// items created between the monitor calls
+	const int batchSize = 256;
+	const qint64 total = g.nodes.size() + g.edges.size();
+	qint64 done = 0;
+
+	auto nextItem = [&]() -> bool
 	{
-		createClassAttribute("", attr.id, attr.name, attr.defaultValue);
-	}
+		if (monitor && (++done % batchSize) == 0 && !monitor->onProgress(done, total))
+		{
+			reset();
+			return false;
+		}
+		return true;
+	};
 
-	for (auto it = g.attrs.constBegin(); it != g.attrs.constEnd(); ++it)
+	// new attributes are created, the existing ones take the default value (if any)
+	auto setClassAttrs = [&](const QByteArray& classId, const AttributeInfos& attrs)
 	{
-		setClassAttribute("", it.key(), it.value());
-	}
+		for (const auto& attr : attrs)
+		{
+			if (createClassAttribute(classId, attr.id, attr.name, attr.defaultValue))
+			{
+				if (attr.valueType && !attr.defaultValue.isValid())
+				{
+					CAttribute newAttr = getClassAttribute(classId, attr.id, false);
+					newAttr.valueType = attr.valueType;
+					setClassAttribute(classId, newAttr);
+				}
+			}
+			else if (attr.defaultValue.isValid())
+				setClassAttribute(classId, attr.id, attr.defaultValue);
+		}
+	};
 
+	setClassAttrs("", g.graphAttrs);
 
-	for (const auto& attr : g.nodeAttrs)
+	for (auto it = g.attrs.constBegin(); it != g.attrs.constEnd(); ++it)
 	{
-		createClassAttribute("node", attr.id, attr.name, attr.defaultValue);
+		setClassAttribute("", it.key(), it.value());
 	}
 
+	setClassAttrs("node", g.nodeAttrs);
+	setClassAttrs("edge", g.edgeAttrs);
 
-	for (const auto& attr : g.edgeAttrs)
+	for (auto it = g.visibleAttrs.constBegin(); it != g.visibleAttrs.constEnd(); ++it)
 	{
-		createClassAttribute("edge", attr.id, attr.name, attr.defaultValue);
+		for (const auto& attrId : it.value())
+			setClassAttributeVisible(it.key(), attrId);
 	}
 
 
@@ -89,6 +118,9 @@ bool CNodeEditorScene::fromGraph(const Graph& g)
 		{
 			/*CNodePort* port =*/ node->addPort(it.key().toLocal8Bit());
 		}
+
+		if (!nextItem())
+			return false;
 	}
 
 
@@ -97,7 +129,10 @@ bool CNodeEditorScene::fromGraph(const Graph& g)
 		CEdge* edge = createNewConnection();
 		addItem(edge);
 
-		edge->setId(e.id);
+		// else the default one is kept
+		if (e.id.size())
+			edge->setId(e.id);
+
 		edge->setFirstNode(nodesMap[e.startNodeId], e.startPortId);
 		edge->setLastNode(nodesMap[e.endNodeId], e.endPortId);
 
@@ -105,6 +140,9 @@ bool CNodeEditorScene::fromGraph(const Graph& g)
 		{
 			edge->setAttribute(it.key(), it.value());
 		}
+
+		if (!nextItem())
+			return false;
 	}
 
 	// finalize
@@ -120,40 +158,38 @@ bool CNodeEditorScene::toGraph(Graph& g)
 {
 	g.clear();
 
-	auto graphAttrs = getClassAttributes("", false);
-	for (auto it = graphAttrs.constBegin(); it != graphAttrs.constEnd(); ++it)
+	// virtual attributes are taken from the items; defaults which make no sense are not stored
+	auto getClassAttrs = [&](const QByteArray& classId, AttributeInfos& attrs)
 	{
-		AttrInfo attr = *it;
-		if (attr.name.isEmpty())
-			attr.name = QString(attr.id);
-		g.graphAttrs[it.key()] = attr;
-	}
+		auto classAttrs = getClassAttributes(classId, false);
+		for (auto it = classAttrs.constBegin(); it != classAttrs.constEnd(); ++it)
+		{
+			if (it->isVirtual)
+				continue;
+
+			AttrInfo attr = *it;
+			if (attr.name.isEmpty())
+				attr.name = QString(attr.id);
+			if (it->noDefault)
+				attr.defaultValue = QVariant();
+			attrs[it.key()] = attr;
+		}
 
-	auto nodeAttrs = getClassAttributes("node", false);
-	for (auto it = nodeAttrs.constBegin(); it != nodeAttrs.constEnd(); ++it)
-	{
-		AttrInfo attr = *it;
-		if (attr.name.isEmpty())
-			attr.name = QString(attr.id);
-		g.nodeAttrs[it.key()] = attr;
-	}
+		QSet<QByteArray> visAttrs = getVisibleClassAttributes(classId, false);
+		if (visAttrs.size())
+			g.visibleAttrs[classId] = visAttrs;
+	};
 
-	auto edgeAttrs = getClassAttributes("edge", false);
-	for (auto it = edgeAttrs.constBegin(); it != edgeAttrs.constEnd(); ++it)
-	{
-		AttrInfo attr = *it;
-		if (attr.name.isEmpty())
-			attr.name = QString(attr.id);
-		g.edgeAttrs[it.key()] = attr;
-	}
+	getClassAttrs("", g.graphAttrs);
+	getClassAttrs("node", g.nodeAttrs);
+	getClassAttrs("edge", g.edgeAttrs);
 
 
 	// nodes
-	auto nodes = getItems<CNode>();
-	for (const auto &node : nodes)
+	for (const auto &node : m_nodesRegistry)
 	{
 		Node n;
-		n.id = node->getId().toLocal8Bit();
+		n.id = node->getId().toUtf8();
 		
 		QByteArrayList ports = node->getPortIds();
 		for (const auto &portId : ports)
@@ -170,19 +206,20 @@ bool CNodeEditorScene::toGraph(Graph& g)
 		}
 
 		n.attrs = node->getLocalAttributes();
+		n.attrs["x"] = node->x();
+		n.attrs["y"] = node->y();
 
 		g.nodes.append(n);
 	}
 
 
 	// edges
-	auto edges = getItems<CEdge>();
-	for (const auto &edge : edges)
+	for (const auto &edge : m_edgesRegistry)
 	{
 		Edge e;
-		e.id = edge->getId().toLocal8Bit();
-		e.startNodeId = edge->firstNode()->getId().toLocal8Bit();
-		e.endNodeId = edge->lastNode()->getId().toLocal8Bit();
+		e.id = edge->getId().toUtf8();
+		e.startNodeId = edge->firstNode()->getId().toUtf8();
+		e.endNodeId = edge->lastNode()->getId().toUtf8();
 		e.startPortId = edge->firstPortId();
 		e.endPortId = edge->lastPortId();
 
@@ -204,6 +241,10 @@ void CNodeEditorScene::initialize()
 {
 	Super::initialize();
 
+	m_nodesRegistry.clear();
+	m_edgesRegistry.clear();
+	m_portsRegistry.clear();
+
 
 	// common constrains
 	static CAttributeConstrainsList *edgeStyles = new CAttributeConstrainsList();
@@ -273,6 +314,62 @@ void CNodeEditorScene::initialize()
 }
 
 
+// registries
+
+void CNodeEditorScene::onItemAdded(CItem *citem)
+{
+	Super::onItemAdded(citem);
+
+	if (CNode* node = dynamic_cast<CNode*>(citem))
+	{
+		m_nodesRegistry.add(node);
+
+		for (auto port : node->getPorts())
+			m_portsRegistry.add(port);
+
+		return;
+	}
+
+	if (CEdge* edge = dynamic_cast<CEdge*>(citem))
+	{
+		m_edgesRegistry.add(edge);
+	}
+}
+
+
+void CNodeEditorScene::onItemRemoved(CItem *citem)
+{
+	Super::onItemRemoved(citem);
+
+	if (CNode* node = dynamic_cast<CNode*>(citem))
+	{
+		m_nodesRegistry.remove(node);
+
+		for (auto port : node->getPorts())
+			m_portsRegistry.remove(port);
+
+		return;
+	}
+
+	if (CEdge* edge = dynamic_cast<CEdge*>(citem))
+	{
+		m_edgesRegistry.remove(edge);
+	}
+}
+
+
+void CNodeEditorScene::onPortAdded(CNodePort *port)
+{
+	m_portsRegistry.add(port);
+}
+
+
+void CNodeEditorScene::onPortRemoved(CNodePort *port)
+{
+	m_portsRegistry.remove(port);
+}
+
+
 // nodes creation
 
 void CNodeEditorScene::setEditMode(EditMode mode)
@@ -800,47 +897,310 @@ bool CNodeEditorScene::doUpdateCursorState(Qt::KeyboardModifiers keys, Qt::Mouse
 
 // painting
 
+// Straight edges of the same pen collected to be drawn by single calls.
+// Buckets are kept in order of appearance, so the result does not depend on hashing.
+
+class CEdgeBatches
+{
+public:
+	void add(CDirectEdge* edge, const QStyleOptionGraphicsItem* option, const QPen& pen, bool withArrows)
+	{
+		PenKey key = { pen.color().rgba(), pen.widthF(), pen.style() };
+
+		int index = m_index.value(key, -1);
+		if (index < 0)
+		{
+			index = m_buckets.size();
+			m_index[key] = index;
+			m_buckets.append(Bucket());
+			m_buckets.last().pen = pen;
+		}
+
+		Bucket& bucket = m_buckets[index];
+		bucket.lines.append(edge->line());
+
+		if (withArrows && (edge->itemFlags() & CF_Mutual_Arrows))
+			bucket.arrows.append(qMakePair(edge, option));
+	}
+
+	void flush(QPainter* painter)
+	{
+		if (m_buckets.isEmpty())
+			return;
+
+		painter->save();
+		painter->setOpacity(1.0);
+		painter->setBrush(Qt::NoBrush);
+
+		for (const auto& bucket : m_buckets)
+		{
+			painter->setPen(bucket.pen);
+			painter->drawLines(bucket.lines);
+
+			for (const auto& arrow : bucket.arrows)
+				arrow.first->drawArrows(painter, arrow.second);
+		}
+
+		painter->restore();
+
+		m_buckets.clear();
+		m_index.clear();
+	}
+
+private:
+	struct PenKey
+	{
+		QRgb color;
+		qreal width;
+		int style;
+
+		bool operator == (const PenKey& other) const {
+			return color == other.color && width == other.width && style == other.style;
+		}
+	};
+
+	friend uint qHash(const PenKey& key, uint seed = 0) {
+		return qHash(key.color, seed) ^ qHash(key.width, seed) ^ uint(key.style);
+	}
+
+	struct Bucket
+	{
+		QPen pen;
+		QVector<QLineF> lines;
+		QVector<QPair<CDirectEdge*, const QStyleOptionGraphicsItem*>> arrows;
+	};
+
+	QVector<Bucket> m_buckets;
+	QHash<PenKey, int> m_index;
+};
+
+
+// returns the edge if it can be drawn within a batch, else the item is painted by QGraphicsScene
+static CDirectEdge* batchableEdge(QGraphicsItem* item, const QStyleOptionGraphicsItem& option)
+{
+	if (option.state & (QStyle::State_Selected | QStyle::State_MouseOver))
+		return nullptr;
+
+	CDirectEdge* edge = dynamic_cast<CDirectEdge*>(item);
+	if (edge == nullptr || !edge->isBatchable())
+		return nullptr;
+
+	if (item->parentItem() || item->effectiveOpacity() < 1.0 || !item->sceneTransform().isIdentity())
+		return nullptr;
+
+	if (item->cacheMode() != QGraphicsItem::NoCache)
+		return nullptr;
+
+	// the children (i.e. label) would be painted along with the edge
+	for (auto child : item->childItems())
+		if (child->isVisible())
+			return nullptr;
+
+	return edge;
+}
+
+
 void CNodeEditorScene::drawBackground(QPainter *painter, const QRectF &r)
 {
     Super::drawBackground(painter, r);
 }
 
 
+void CNodeEditorScene::setFrameBudget(int ms)
+{
+	m_frameBudget = qMax(0, ms);
+
+	// drop the frame in progress & the buffers
+	m_nextIndex = 0;
+	m_backBuffer = m_frontBuffer = QImage();
+	m_frontRegion = QRegion();
+
+	update();
+}
+
+
+// draws buffer of the device pixels (mapped to the current view if it was painted for another one)
+static void drawFrameBuffer(QPainter *painter, const QImage& buffer, const QTransform& mapping = QTransform())
+{
+	painter->save();
+	painter->setTransform(mapping);
+	painter->drawImage(QPointF(0, 0), buffer);
+	painter->restore();
+}
+
+
 void CNodeEditorScene::drawItems(QPainter *painter, int numItems, QGraphicsItem *items[],
                                  const QStyleOptionGraphicsItem options[],
                                  QWidget *widget)
 {
-    QElapsedTimer tm;
-    tm.start();
+	// all at once
+	if (m_frameBudget <= 0 || widget == nullptr)
+	{
+		drawItemsPart(painter, 0, numItems, items, options, widget, nullptr);
+		return;
+	}
 
-    static int maxtime = 0;
+	// progressive: the items are painted into the back buffer by time slices
+	QPaintDevice *device = painter->device();
+	QSize deviceSize(device->width(), device->height());
+	qreal dpr = device->devicePixelRatioF();
 
-    // test only
-//    Super::drawItems(painter, numItems, items, options, widget);
+	QRect clipRect(QPoint(), deviceSize);
+	if (painter->hasClipping())
+		clipRect &= painter->worldTransform().mapRect(painter->clipBoundingRect()).toAlignedRect();
 
-    for (int i = m_nextIndex; i < numItems; ++i)
-    {
-        // Draw the item
-        painter->save();
-        painter->setTransform(items[i]->sceneTransform(), true);
-        items[i]->paint(painter, &options[i], widget);
-        painter->restore();
-
-//        if (tm.elapsed() > 50)
-//        {
-//            m_nextIndex = i+1;
-//            update();
-//            return;
-//        }
-    }
+	FrameKey key;
+	key.transform = painter->worldTransform();
+	key.size = deviceSize;
+	key.clip = clipRect;
+	key.numItems = numItems;
+
+	// start new frame
+	if (m_nextIndex == 0 || !(key == m_frameKey) || m_backBuffer.isNull())
+	{
+		// unfinished frame of another area is dropped: it has to be painted again
+		if (m_nextIndex > 0 && key.transform == m_frameKey.transform && key.size == m_frameKey.size)
+		{
+			QRect lostRect = m_frameKey.clip;
+			QTimer::singleShot(0, widget, [widget, lostRect]() { widget->update(lostRect); });
+		}
+
+		m_frameKey = key;
+		m_frameRevision = getRevision();
+		m_nextIndex = 0;
+
+		if (m_backBuffer.size() != deviceSize * dpr)
+		{
+			m_backBuffer = QImage(deviceSize * dpr, QImage::Format_ARGB32_Premultiplied);
+			m_backBuffer.setDevicePixelRatio(dpr);
+		}
+
+		m_backBuffer.fill(Qt::transparent);
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	// no complete frame to show meanwhile: the first one is finished at once
+	const bool finishNow = m_frontBuffer.isNull();
+
+	QPainter bufferPainter(&m_backBuffer);
+	bufferPainter.setRenderHints(painter->renderHints());
+	bufferPainter.setClipRect(clipRect);
+	bufferPainter.setWorldTransform(key.transform);
 
-    m_nextIndex = 0;
+	m_nextIndex = drawItemsPart(&bufferPainter, m_nextIndex, numItems, items, options, widget, finishNow ? nullptr : &timer);
 
-    if (tm.elapsed() > maxtime)
+	bufferPainter.end();
+
+	bool frontValid = !m_frontBuffer.isNull() && m_frontBuffer.size() == m_backBuffer.size() && m_frontTransform == key.transform;
+
+	// not finished: continue after the pending events, show the last complete frame meanwhile
+	// (the partial one is never shown); after a pan or zoom it is mapped to the new view
+	if (m_nextIndex < numItems)
+	{
+		QTimer::singleShot(0, widget, [widget, clipRect]() { widget->update(clipRect); });
+
+		if (frontValid)
+			drawFrameBuffer(painter, m_frontBuffer);
+		else
+			drawFrameBuffer(painter, m_frontBuffer, m_frontTransform.inverted() * key.transform);
+
+		return;
+	}
+
+	// finished; the items changed meanwhile could be painted in the old state, so one more frame is needed
+	m_nextIndex = 0;
+
+	if (getRevision() != m_frameRevision)
+		QTimer::singleShot(0, widget, [widget, clipRect]() { widget->update(clipRect); });
+
+	if (frontValid)
+	{
+		QPainter frontPainter(&m_frontBuffer);
+		frontPainter.setCompositionMode(QPainter::CompositionMode_Source);
+		frontPainter.setClipRect(clipRect);
+		frontPainter.drawImage(QPointF(0, 0), m_backBuffer);
+		frontPainter.end();
+
+		m_frontRegion += clipRect;
+	}
+	else
+	{
+		qSwap(m_frontBuffer, m_backBuffer);
+		m_frontTransform = key.transform;
+		m_frontRegion = clipRect;
+	}
+
+	drawFrameBuffer(painter, m_frontBuffer);
+}
+
+
+int CNodeEditorScene::drawItemsPart(QPainter *painter, int from, int numItems, QGraphicsItem *items[],
+	const QStyleOptionGraphicsItem options[],
+	QWidget *widget, const QElapsedTimer* timer)
+{
+	// edges are painted in scene coordinates, so the level of detail is the same for all of them
+	const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+	const bool hairlines = (lod < lod_edge_zoom);
+
+	CEdgeBatches batches;
+
+	// items which are not batched are painted by QGraphicsScene (opacity, clipping, caching etc.)
+	// by runs; it paints the whole subtrees of their toplevel items
+	int runStart = -1;
+	auto flushRun = [&](int runEnd)
+	{
+		if (runStart >= 0)
+			Super::drawItems(painter, runEnd - runStart, items + runStart, options + runStart, widget);
+
+		runStart = -1;
+	};
+
+	int lastCheck = from;
+
+    for (int i = from; i < numItems; ++i)
     {
-        maxtime = tm.elapsed();
-        qDebug() << tm.elapsed();
+		// time is over: the rest goes to the next frame (checked by portions, the timer is not free);
+		// a subtree must not be split, so only before a toplevel item
+		if (timer && i - lastCheck >= 64 && items[i]->parentItem() == nullptr)
+		{
+			lastCheck = i;
+
+			if (timer->elapsed() > m_frameBudget)
+			{
+				flushRun(i);
+				batches.flush(painter);
+				return i;
+			}
+		}
+
+		if (CDirectEdge* edge = batchableEdge(items[i], options[i]))
+		{
+			flushRun(i);
+
+			QPen pen = edge->getPaintPen();
+			if (hairlines)
+			{
+				pen.setWidth(0);
+				pen.setStyle(Qt::SolidLine);
+			}
+
+			batches.add(edge, &options[i], pen, !hairlines);
+			continue;
+		}
+
+		// keep the stacking order: the batched edges are below this item
+		batches.flush(painter);
+
+		if (runStart < 0)
+			runStart = i;
     }
+
+	flushRun(numItems);
+	batches.flush(painter);
+
+	return numItems;
 }
 
 
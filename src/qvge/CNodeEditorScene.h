@@ -11,6 +11,12 @@ It can be used freely, maintaining the information above.
 
 #include "CEditorScene.h"
 
+#include <QImage>
+#include <QRegion>
+#include <QTransform>
+
+class QElapsedTimer;
+
 class CNode;
 class CEdge;
 class CNodePort;
@@ -32,6 +38,10 @@ class CNodeEditorScene : public CEditorScene
 public:
 	typedef CEditorScene Super;
 
+	typedef CItemRegistry<CNode, IRS_Kind> NodesRegistry;
+	typedef CItemRegistry<CEdge, IRS_Kind> EdgesRegistry;
+	typedef CItemRegistry<CNodePort> PortsRegistry;
+
 	CNodeEditorScene(QObject *parent = NULL);
 
 	// reimp
@@ -40,7 +50,7 @@ public:
 	}
 
 	virtual void initialize();
-	virtual bool fromGraph(const Graph& g);
+	virtual bool fromGraph(const Graph& g, IProgressMonitor* monitor = nullptr);
 	virtual bool toGraph(Graph& g);
 
 	// operations
@@ -61,6 +71,17 @@ public:
 	void setNodesFactory(CNode* node);
 	void setEdgesFactory(CEdge* node);
 
+	// items of the scene by kind (iteration does not allocate)
+	const NodesRegistry& getNodesRegistry() const { return m_nodesRegistry; }
+	const EdgesRegistry& getEdgesRegistry() const { return m_edgesRegistry; }
+	const PortsRegistry& getPortsRegistry() const { return m_portsRegistry; }
+
+	// registries maintenance
+	virtual void onItemAdded(CItem *citem);
+	virtual void onItemRemoved(CItem *citem);
+	void onPortAdded(CNodePort *port);
+	void onPortRemoved(CNodePort *port);
+
     // selections
     virtual void moveSelectedItemsBy(const QPointF& d);
 
@@ -68,6 +89,11 @@ public:
     const QList<CEdge*>& getSelectedEdges() const;
 	const QList<CItem*>& getSelectedNodesEdges() const;
 
+	// progressive rendering: items are painted by time slices of ms milliseconds per frame
+	// (the last complete frame is shown meanwhile); 0 paints all the items at once
+	void setFrameBudget(int ms);
+	int getFrameBudget() const { return m_frameBudget; }
+
 Q_SIGNALS:
 	void editModeChanged(int mode);
 
@@ -108,6 +134,11 @@ protected:
                            QGraphicsItem *items[],
                            const QStyleOptionGraphicsItem options[],
                            QWidget *widget = Q_NULLPTR);
+	// paints items from the given one until the time of the frame is over (if timer is set); returns index of the next item to paint
+	int drawItemsPart(QPainter *painter, int from, int numItems,
+		QGraphicsItem *items[], const QStyleOptionGraphicsItem options[],
+		QWidget *widget, const QElapsedTimer* timer);
+
 protected:
 	// edit mode
 	EditMode m_editMode;
@@ -126,13 +157,40 @@ protected:
 	CNode *m_nodesFactory = 0;
 	CEdge *m_edgesFactory = 0;
 
+	// registries
+	NodesRegistry m_nodesRegistry;
+	EdgesRegistry m_edgesRegistry;
+	PortsRegistry m_portsRegistry;
+
     // cached selections
     mutable QList<CNode*> m_selNodes;
 	mutable QList<CEdge*> m_selEdges;
 	mutable QList<CItem*> m_selItems;
 
     // drawing
+	int m_frameBudget = 0;
     int m_nextIndex = 0;
+
+	// the frame in progress is continued only if it is painted the same way;
+	// changes of the items do not restart it (else it would never finish while dragging)
+	struct FrameKey
+	{
+		QTransform transform;
+		QSize size;
+		QRect clip;
+		int numItems = 0;
+
+		bool operator == (const FrameKey& other) const {
+			return transform == other.transform && size == other.size && clip == other.clip && numItems == other.numItems;
+		}
+	};
+
+	FrameKey m_frameKey;
+	QImage m_backBuffer;	// frame in progress
+	QImage m_frontBuffer;	// complete frames
+	QTransform m_frontTransform;
+	QRegion m_frontRegion;
+	quint64 m_frameRevision = 0;	// scene revision at start of the frame
 };
 
 
@@ -9,6 +9,7 @@ It can be used freely, maintaining the information above.
 
 #include "CNodePort.h"
 #include "CNode.h"
+#include "CNodeEditorScene.h"
 
 
 CNodePort::CNodePort(CNode *node, const QByteArray& portId, int align, double xoff, double yoff) :
@@ -25,11 +26,18 @@ CNodePort::CNodePort(CNode *node, const QByteArray& portId, int align, double xo
 	setToolTip(portId);
 
 	setFlags(QGraphicsItem::ItemClipsToShape | QGraphicsItem::ItemIgnoresParentOpacity);
+
+	// register if the node is already at the scene
+	if (auto nodeScene = dynamic_cast<CNodeEditorScene*>(scene()))
+		nodeScene->onPortAdded(this);
 }
 
 
 CNodePort::~CNodePort()
 {
+	if (auto nodeScene = dynamic_cast<CNodeEditorScene*>(scene()))
+		nodeScene->onPortRemoved(this);
+
 	if (m_node)
 		m_node->onPortDeleted(this);
 }
@@ -75,13 +83,19 @@ void CNodePort::setId(const QByteArray& portId)
 	setToolTip(portId);
 
 	if (m_node)
+	{
 		m_node->onPortRenamed(this, oldId);
+		m_node->notifyItemChanged();
+	}
 }
 
 
 void CNodePort::setAlign(int newAlign)
 {
 	m_align = newAlign;
+
+	if (m_node)
+		m_node->notifyItemChanged();
 }
 
 
@@ -89,6 +103,9 @@ void CNodePort::setOffset(double xoff, double yoff)
 {
 	m_xoff = xoff;
 	m_yoff = yoff;
+
+	if (m_node)
+		m_node->notifyItemChanged();
 }
 
 
@@ -101,6 +118,9 @@ QColor CNodePort::getColor() const
 void CNodePort::setColor(const QColor& color)
 {
 	setBrush(color);
+
+	if (m_node)
+		m_node->notifyItemChanged();
 }
 
 
@@ -39,6 +39,9 @@ public:
 
 	void copyDataFrom(const CNodePort &port);
 
+	// position in the scene's ports registry
+	int& registrySlot(int /*slotId*/) { return m_registrySlot; }
+
 	// serialization 
 	virtual bool storeTo(QDataStream& out, quint64 version64) const;
 	//virtual bool restoreFrom(QDataStream& out, quint64 version64);
@@ -61,5 +64,7 @@ protected:
 	QByteArray m_id;
 	int m_align;
 	double m_xoff, m_yoff;
+
+	int m_registrySlot = -1;
 };
 
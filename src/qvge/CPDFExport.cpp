@@ -21,6 +21,8 @@ bool CPDFExport::save(const QString& fileName, CEditorScene& scene, QString* /*l
 
 	tempScene->crop();
 
+	tempScene->layoutItemLabels(tempScene->sceneRect(), false);
+
 	QPrinter printer(QPrinter::HighResolution);
 	printer.setPageSize(QPrinter::A4);
 	printer.setOrientation(QPrinter::Portrait);
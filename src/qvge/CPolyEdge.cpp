@@ -24,6 +24,8 @@ void CPolyEdge::setPoints(const QList<QPointF> &points)
 	m_polyPoints = points;
 
 	onParentGeometryChanged();
+
+	notifyItemChanged();
 }
 
 
@@ -185,6 +187,9 @@ void CPolyEdge::onItemMoved(const QPointF& delta)
 		p += delta;
 	}
 
+	if (m_polyPoints.size())
+		notifyItemChanged();
+
 	for (auto cp : m_controlPoints)
 	{
 		cp->moveBy(delta.x(), delta.y());
@@ -378,4 +383,6 @@ void CPolyEdge::updateShapeFromPoints()
 	}
 
 	onParentGeometryChanged();
+
+	notifyItemChanged();
 }
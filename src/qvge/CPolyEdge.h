@@ -35,6 +35,7 @@ public:
 	CEdge* clone();
 
 	virtual void reverse();
+	virtual bool isBatchable() const { return false; }
 
 	// serialization 
 	virtual bool storeTo(QDataStream& out, quint64 version64) const;
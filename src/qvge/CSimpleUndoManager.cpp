@@ -10,6 +10,7 @@ It can be used freely, maintaining the information above.
 
 #include "CSimpleUndoManager.h"
 #include "CEditorScene.h"
+#include "CItem.h"
 
 #include <QDataStream>
 
@@ -18,66 +19,75 @@ CSimpleUndoManager::CSimpleUndoManager(CEditorScene & scene)
 	: m_scene(&scene),
 	m_stackIndex(-1)
 {
+	m_pipeline.setCommitFunction([this](const QByteArray& compressedSnap) {
+		m_stateStack.append(compressedSnap);
+	});
 }
 
 void CSimpleUndoManager::reset()
 {
+	m_pipeline.clear();
+
 	m_stackIndex = -1;
 	m_stateStack.clear();
 }
 
 void CSimpleUndoManager::addState()
 {
-	// serialize & compress
+	// serialize by item states: they keep their sizes, so undo can compare them with the live items
+	QMap<quint64, QByteArray> itemStates;
+	for (CItem* item : m_scene->getItemsRegistry())
+		itemStates[item->uid()] = m_scene->storeItemState(*item);
+
 	QByteArray snap;
 	QDataStream ds(&snap, QIODevice::WriteOnly);
-	m_scene->storeTo(ds, false);
-	QByteArray compressedSnap = qCompress(snap);
+	ds << itemStates << m_scene->storeSceneState();
 
-	// push state into stack
-	if (m_stateStack.size() == ++m_stackIndex)
+	// drop redo states
+	if (m_stackIndex + 1 < stateCount())
 	{
-		m_stateStack.append(compressedSnap);
+		m_pipeline.flush();
+		m_stateStack.truncate(m_stackIndex + 1);
 	}
-	else
-	{
-		while (m_stateStack.size() > m_stackIndex)
-			m_stateStack.takeLast();
 
-		m_stateStack.append(compressedSnap);
-	}
+	// push state into stack: compressed in background
+	++m_stackIndex;
+
+	m_pipeline.post([snap]() {
+		return qCompress(snap);
+	});
 }
 
 void CSimpleUndoManager::revertState()
 {
+	m_pipeline.flush();
+
 	if (availableUndoCount())
 	{
-		QByteArray &compressedSnap = m_stateStack[m_stackIndex];
-		QByteArray snap = qUncompress(compressedSnap);
-		QDataStream ds(&snap, QIODevice::ReadOnly);
-		m_scene->restoreFrom(ds, false);
+		QByteArray compressedSnap = m_stateStack.at(m_stackIndex);
+		restoreSnapshot(compressedSnap);
 	}
 }
 
 void CSimpleUndoManager::undo()
 {
+	m_pipeline.flush();
+
 	if (availableUndoCount())
 	{
-		QByteArray &compressedSnap = m_stateStack[--m_stackIndex];
-		QByteArray snap = qUncompress(compressedSnap);
-		QDataStream ds(&snap, QIODevice::ReadOnly);
-		m_scene->restoreFrom(ds, false);
+		QByteArray compressedSnap = m_stateStack.at(--m_stackIndex);
+		restoreSnapshot(compressedSnap);
 	}
 }
 
 void CSimpleUndoManager::redo()
 {
+	m_pipeline.flush();
+
 	if (availableRedoCount())
 	{
-		QByteArray &compressedSnap = m_stateStack[++m_stackIndex];
-		QByteArray snap = qUncompress(compressedSnap);
-		QDataStream ds(&snap, QIODevice::ReadOnly);
-		m_scene->restoreFrom(ds, false);
+		QByteArray compressedSnap = m_stateStack.at(++m_stackIndex);
+		restoreSnapshot(compressedSnap);
 	}
 }
 
@@ -88,5 +98,31 @@ int CSimpleUndoManager::availableUndoCount() const
 
 int CSimpleUndoManager::availableRedoCount() const
 {
-	return (m_stackIndex >= 0) && (m_stackIndex < m_stateStack.size() - 1);
+	return (m_stackIndex >= 0) && (m_stackIndex < stateCount() - 1);
+}
+
+int CSimpleUndoManager::stateCount() const
+{
+	return m_stateStack.size() + m_pipeline.pendingCount();
+}
+
+bool CSimpleUndoManager::setMemoryLimit(qint64 bytes, const QString& journalPath)
+{
+	m_stateStack.setJournalPath(journalPath);
+	return m_stateStack.setMemoryLimit(bytes);
+}
+
+
+// privates
+
+void CSimpleUndoManager::restoreSnapshot(const QByteArray& compressedSnap)
+{
+	QByteArray snap = qUncompress(compressedSnap);
+	QDataStream ds(&snap, QIODevice::ReadOnly);
+
+	QMap<quint64, QByteArray> itemStates;
+	QByteArray sceneState;
+	ds >> itemStates >> sceneState;
+
+	m_scene->restoreFromStates(itemStates, sceneState, false);
 }
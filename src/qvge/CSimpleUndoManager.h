@@ -11,6 +11,8 @@ It can be used freely, maintaining the information above.
 #define CSIMPLEUNDOMANAGER_H
 
 #include "IUndoManager.h"
+#include "CUndoJournal.h"
+#include "CUndoPipeline.h"
 
 #include <QtCore/QByteArray>
 #include <QtCore/QList>
@@ -31,11 +33,16 @@ public:
 	virtual void redo();
 	virtual int availableUndoCount() const;
 	virtual int availableRedoCount() const;
+	virtual bool setMemoryLimit(qint64 bytes, const QString& journalPath = QString());
 
 private:
+	int stateCount() const;
+	void restoreSnapshot(const QByteArray& compressedSnap);
+
 	CEditorScene *m_scene;
-	QList<QByteArray> m_stateStack;
+	CUndoJournal m_stateStack;
 	int m_stackIndex;
+	CUndoPipeline<QByteArray> m_pipeline;
 };
 
 #endif // CUNDOMANAGER_H
@@ -0,0 +1,86 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#include "CSpatialGrid.h"
+
+#include <cmath>
+
+
+CSpatialGrid::CSpatialGrid(qreal cellSize):
+	m_cellSize(qMax(cellSize, 1.0))
+{
+}
+
+
+void CSpatialGrid::clear()
+{
+	m_rects.clear();
+	m_cells.clear();
+}
+
+
+CSpatialGrid::CellRange CSpatialGrid::cellRange(const QRectF& r) const
+{
+	CellRange range;
+	range.left = int(std::floor(r.left() / m_cellSize));
+	range.top = int(std::floor(r.top() / m_cellSize));
+	range.right = int(std::floor(r.right() / m_cellSize));
+	range.bottom = int(std::floor(r.bottom() / m_cellSize));
+	return range;
+}
+
+
+bool CSpatialGrid::intersects(const QRectF& r) const
+{
+	if (m_rects.isEmpty())
+		return false;
+
+	CellRange range = cellRange(r);
+
+	for (int x = range.left; x <= range.right; ++x)
+	{
+		for (int y = range.top; y <= range.bottom; ++y)
+		{
+			auto it = m_cells.constFind(cellKey(x, y));
+			if (it == m_cells.constEnd())
+				continue;
+
+			for (int index : it.value())
+			{
+				if (m_rects.at(index).intersects(r))
+					return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+void CSpatialGrid::add(const QRectF& r)
+{
+	int index = m_rects.size();
+	m_rects.append(r);
+
+	CellRange range = cellRange(r);
+
+	for (int x = range.left; x <= range.right; ++x)
+		for (int y = range.top; y <= range.bottom; ++y)
+			m_cells[cellKey(x, y)].append(index);
+}
+
+
+bool CSpatialGrid::addIfFree(const QRectF& r)
+{
+	if (intersects(r))
+		return false;
+
+	add(r);
+	return true;
+}
@@ -0,0 +1,53 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QRectF>
+#include <QVector>
+#include <QHash>
+
+
+// Occupancy of the plane by rectangles, hashed by the cells of a uniform grid.
+// A rectangle is tested only against the ones sharing its cells, so checking
+// n rectangles of similar size costs O(n) instead of O(n^2).
+// Cell size should be about the size of the typical rectangle.
+
+class CSpatialGrid
+{
+public:
+	explicit CSpatialGrid(qreal cellSize = 64);
+
+	void clear();
+
+	// returns true if r overlaps some of the added rectangles
+	bool intersects(const QRectF& r) const;
+
+	void add(const QRectF& r);
+
+	// adds r if it is free; returns true if added
+	bool addIfFree(const QRectF& r);
+
+private:
+	struct CellRange
+	{
+		int left, top, right, bottom;
+	};
+
+	CellRange cellRange(const QRectF& r) const;
+
+	static quint64 cellKey(int x, int y)
+	{
+		return (quint64(quint32(x)) << 32) | quint32(y);
+	}
+
+	qreal m_cellSize;
+	QVector<QRectF> m_rects;
+	QHash<quint64, QVector<int>> m_cells;	// cell -> indices of the rectangles
+};
@@ -0,0 +1,220 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#include "CUndoJournal.h"
+
+#include <QTemporaryFile>
+#include <QDir>
+#include <QDebug>
+
+
+CUndoJournal::CUndoJournal()
+{
+}
+
+
+CUndoJournal::~CUndoJournal()
+{
+	closeJournal();
+}
+
+
+bool CUndoJournal::setMemoryLimit(qint64 bytes)
+{
+	m_memoryLimit = qMax(qint64(0), bytes);
+	m_errorString.clear();
+
+	return spill();
+}
+
+
+void CUndoJournal::setJournalPath(const QString& path)
+{
+	// used by the next journal file only
+	m_journalPath = path;
+}
+
+
+bool CUndoJournal::append(const QByteArray& record)
+{
+	Record r = { record, -1, record.size() };
+	m_records.append(r);
+
+	m_memorySize += record.size();
+
+	return spill();
+}
+
+
+QByteArray CUndoJournal::at(int index) const
+{
+	Q_ASSERT(index >= 0 && index < m_records.size());
+
+	if (index < m_spilledCount)
+		return readSpilled(index);
+	else
+		return m_records.at(index).data;
+}
+
+
+QByteArray CUndoJournal::takeLast()
+{
+	Q_ASSERT(!m_records.isEmpty());
+
+	QByteArray record = at(m_records.size() - 1);
+
+	truncate(m_records.size() - 1);
+
+	return record;
+}
+
+
+void CUndoJournal::truncate(int count)
+{
+	while (m_records.size() > count)
+	{
+		Record r = m_records.takeLast();
+
+		if (m_records.size() < m_spilledCount)
+			m_spilledCount = m_records.size();
+		else
+			m_memorySize -= r.size;
+	}
+
+	// the file is append-only: drop it when nothing refers to it anymore
+	if (m_spilledCount == 0)
+		closeJournal();
+}
+
+
+void CUndoJournal::clear()
+{
+	m_records.clear();
+	m_spilledCount = 0;
+	m_memorySize = 0;
+
+	closeJournal();
+}
+
+
+// privates
+
+bool CUndoJournal::spill()
+{
+	if (m_memoryLimit <= 0)
+		return m_errorString.isEmpty();
+
+	// the most recent record always stays in memory
+	while (m_memorySize > m_memoryLimit && m_spilledCount < m_records.size() - 1)
+	{
+		if (!m_journal && !openJournal())
+			return false;
+
+		// the mapping is restored on demand
+		if (m_map)
+		{
+			m_journal->unmap(m_map);
+			m_map = nullptr;
+			m_mapSize = 0;
+		}
+
+		Record &r = m_records[m_spilledCount];
+
+		qint64 offset = m_journal->size();
+		// the record is dropped from memory only once it is safely written
+		if (!m_journal->seek(offset) || m_journal->write(r.data) != r.size || !m_journal->flush())
+		{
+			setError(QString("cannot write to %1: %2").arg(m_journal->fileName(), m_journal->errorString()));
+			return false;
+		}
+
+		r.offset = offset;
+		r.data.clear();
+
+		m_memorySize -= r.size;
+		m_spilledCount++;
+	}
+
+	return true;
+}
+
+
+void CUndoJournal::setError(const QString& error)
+{
+	m_errorString = error;
+
+	qWarning() << "CUndoJournal:" << error << "- keeping the undo records in memory";
+
+	// do not try again
+	m_memoryLimit = 0;
+}
+
+
+bool CUndoJournal::openJournal()
+{
+	QStringList dirs;
+	if (m_journalPath.size())
+		dirs << m_journalPath;
+	dirs << QDir::tempPath();
+
+	for (const QString& dir : dirs)
+	{
+		m_journal = new QTemporaryFile(dir + "/.qvge-undo-XXXXXX");
+		if (m_journal->open())
+			return true;
+
+		delete m_journal;
+		m_journal = nullptr;
+	}
+
+	setError("cannot create journal file");
+	return false;
+}
+
+
+void CUndoJournal::closeJournal()
+{
+	if (m_journal)
+	{
+		if (m_map)
+			m_journal->unmap(m_map);
+
+		delete m_journal;
+		m_journal = nullptr;
+	}
+
+	m_map = nullptr;
+	m_mapSize = 0;
+}
+
+
+QByteArray CUndoJournal::readSpilled(int index) const
+{
+	const Record &r = m_records.at(index);
+
+	Q_ASSERT(m_journal);
+
+	// remap if the file has grown since the last mapping
+	if (!m_map || m_mapSize < r.offset + r.size)
+	{
+		if (m_map)
+			m_journal->unmap(m_map);
+
+		m_mapSize = m_journal->size();
+		m_map = m_journal->map(0, m_mapSize);
+	}
+
+	if (m_map)
+		return QByteArray((const char*)m_map + r.offset, r.size);
+
+	// no mapping available: read directly
+	m_mapSize = 0;
+	m_journal->seek(r.offset);
+	return m_journal->read(r.size);
+}
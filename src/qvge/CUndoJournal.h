@@ -0,0 +1,82 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+class QTemporaryFile;
+
+
+// Stack of undo records with a memory budget.
+// When the records take more memory than allowed, the oldest ones are appended
+// to a journal file and read back (via memory mapping) when requested.
+// If the journal cannot be written, the limit is dropped and the records stay in memory.
+
+class CUndoJournal
+{
+public:
+	CUndoJournal();
+	~CUndoJournal();
+
+	// 0 means no limit; returns false if the records could not be moved to the journal
+	bool setMemoryLimit(qint64 bytes);
+	qint64 memoryLimit() const		{ return m_memoryLimit; }
+	qint64 memorySize() const		{ return m_memorySize; }
+
+	// directory to create the journal file in (temp directory if empty or not writable)
+	void setJournalPath(const QString& path);
+	const QString& journalPath() const	{ return m_journalPath; }
+
+	// records
+	int size() const				{ return m_records.size(); }
+	bool isEmpty() const			{ return m_records.isEmpty(); }
+	int spilledCount() const		{ return m_spilledCount; }
+
+	// returns false if the records could not be moved to the journal (they are kept in memory then)
+	bool append(const QByteArray& record);
+	QByteArray at(int index) const;
+	QByteArray takeLast();
+	// keeps first count records only
+	void truncate(int count);
+	void clear();
+
+	CUndoJournal& operator << (const QByteArray& record)	{ append(record); return *this; }
+
+	// last failure of the journal (empty if none)
+	const QString& errorString() const	{ return m_errorString; }
+
+private:
+	bool spill();
+	void setError(const QString& error);
+	bool openJournal();
+	void closeJournal();
+	QByteArray readSpilled(int index) const;
+
+	struct Record
+	{
+		QByteArray data;	// empty if spilled
+		qint64 offset;		// position in the journal file if spilled, -1 else
+		int size;
+	};
+
+	QList<Record> m_records;
+	int m_spilledCount = 0;		// records [0..m_spilledCount) are in the journal file
+
+	qint64 m_memorySize = 0;
+	qint64 m_memoryLimit = 0;
+
+	QString m_journalPath;
+	QString m_errorString;
+	QTemporaryFile *m_journal = nullptr;
+	mutable uchar *m_map = nullptr;
+	mutable qint64 m_mapSize = 0;
+};
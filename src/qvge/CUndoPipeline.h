@@ -0,0 +1,87 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QtCore/QList>
+#include <QtCore/QFuture>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <functional>
+
+
+// Bounded pipeline of the undo records being prepared in the worker threads.
+// Results are committed in the order of posting, from the thread of the owner.
+// When maxPending jobs are running, posting of the next one waits for the oldest.
+
+template<class T>
+class CUndoPipeline
+{
+public:
+	typedef std::function<void(const T&)> CommitFunction;
+
+	explicit CUndoPipeline(int maxPending = 4) : m_maxPending(maxPending) {}
+
+	// uncommitted results are dropped
+	~CUndoPipeline()	{ clear(); }
+
+	void setCommitFunction(const CommitFunction& func)	{ m_commit = func; }
+
+	int pendingCount() const	{ return m_pending.size(); }
+
+	template<class Job>
+	void post(Job job)
+	{
+		commitFinished();
+
+		if (m_pending.size() >= m_maxPending)
+			commitFirst();
+
+		m_pending << QtConcurrent::run(job);
+	}
+
+	// commits the finished results without waiting
+	void commitFinished()
+	{
+		while (m_pending.size() && m_pending.first().isFinished())
+			commitFirst();
+	}
+
+	// waits for all the pending results & commits them
+	void flush()
+	{
+		while (m_pending.size())
+			commitFirst();
+	}
+
+	// waits for the pending jobs without committing
+	void clear()
+	{
+		for (auto &future : m_pending)
+			future.waitForFinished();
+
+		m_pending.clear();
+	}
+
+private:
+	void commitFirst()
+	{
+		QFuture<T> future = m_pending.takeFirst();
+
+		// blocks until ready
+		T result = future.result();
+
+		if (m_commit)
+			m_commit(result);
+	}
+
+	QList<QFuture<T>> m_pending;
+	CommitFunction m_commit;
+	int m_maxPending;
+};
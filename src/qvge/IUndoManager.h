@@ -9,6 +9,10 @@ It can be used freely, maintaining the information above.
 
 #pragma once
 
+#include <QtCore/QString>
+
+class CItem;
+
 
 class IUndoManager
 {
@@ -20,4 +24,13 @@ public:
 	virtual void redo() = 0;
 	virtual int availableUndoCount() const = 0;
 	virtual int availableRedoCount() const = 0;
+
+	// memory budget of the undo history (0: unlimited); the rest goes to a journal file in journalPath.
+	// returns false if the journal cannot be written (the history is kept in memory then)
+	virtual bool setMemoryLimit(qint64 /*bytes*/, const QString& /*journalPath*/ = QString()) { return true; }
+
+	// item change notifications (needed by the managers tracking the changed items only)
+	virtual void onItemAdded(CItem* /*item*/) {}
+	virtual void onItemRemoved(CItem* /*item*/) {}
+	virtual void onItemChanged(CItem* /*item*/) {}
 };
@@ -34,4 +34,7 @@ commonui.file = $$PWD/commonui/commonui.pro
 SUBDIRS += qvgeapp
 qvgeapp.file = $$PWD/qvgeapp/qvgeapp.pro
 
+SUBDIRS += qvgecli
+qvgecli.file = $$PWD/qvgecli/qvgecli.pro
+
 
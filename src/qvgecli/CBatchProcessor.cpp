@@ -0,0 +1,320 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#include "CBatchProcessor.h"
+
+#include <qvge/CNodeEditorScene.h>
+#include <qvge/CFileSerializerXGR.h>
+#include <qvge/CFileSerializerGraphML.h>
+#include <qvge/CFileSerializerGEXF.h>
+#include <qvge/CFileSerializerDOT.h>
+#include <qvge/CFileSerializerCSV.h>
+#include <qvge/CImageExport.h>
+#include <qvge/CPDFExport.h>
+
+#ifdef USE_OGDF
+#include <commonui/ogdf/COGDFLayout.h>
+
+#include <ogdf/planarity/PlanarizationLayout.h>
+#include <ogdf/misclayout/LinearLayout.h>
+#include <ogdf/misclayout/BalloonLayout.h>
+#include <ogdf/misclayout/CircularLayout.h>
+#include <ogdf/energybased/FMMMLayout.h>
+#include <ogdf/layered/SugiyamaLayout.h>
+#endif
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QDir>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QImageWriter>
+
+#include <cstdio>
+
+
+CBatchProcessor::CBatchProcessor(const CBatchOptions& options) :
+	m_options(options),
+	m_out(stdout),
+	m_err(stderr)
+{
+}
+
+
+QStringList CBatchProcessor::layoutNames()
+{
+#ifdef USE_OGDF
+	return { "planar", "linear", "balloon", "circular", "fmmm", "sugiyama" };
+#else
+	return QStringList();
+#endif
+}
+
+
+int CBatchProcessor::run(const QStringList& files)
+{
+	int failed = 0;
+
+	for (const QString& fileName : files)
+	{
+		if (!processFile(fileName))
+			failed++;
+	}
+
+	return failed;
+}
+
+
+int CBatchProcessor::runParallel(const QStringList& files, const QStringList& childArgs)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	QStringList pending = files;
+	QList<QProcess*> running;
+	int failed = 0;
+
+	while (pending.size() || running.size())
+	{
+		// start new ones
+		while (pending.size() && running.size() < m_options.jobs)
+		{
+			auto process = new QProcess;
+			process->setProcessChannelMode(QProcess::MergedChannels);
+			process->start(QCoreApplication::applicationFilePath(), childArgs + QStringList(pending.takeFirst()));
+			running << process;
+		}
+
+		// collect finished ones
+		for (int i = 0; i < running.size(); )
+		{
+			QProcess* process = running.at(i);
+
+			if (process->state() != QProcess::NotRunning && !process->waitForFinished(10))
+			{
+				i++;
+				continue;
+			}
+
+			// not started: looks like a normal exit with code 0
+			if (process->error() == QProcess::FailedToStart)
+			{
+				m_err << QFileInfo(process->arguments().last()).fileName() << ": start failed (" << process->errorString() << ")\n";
+				m_err.flush();
+
+				failed++;
+			}
+			else
+			{
+				// output of the file goes at once, not mixed with the others
+				m_out << process->readAll();
+				m_out.flush();
+
+				if (process->exitStatus() != QProcess::NormalExit || process->exitCode() != 0)
+					failed++;
+			}
+
+			running.removeAt(i);
+			delete process;
+		}
+	}
+
+	m_out << QString("Processed %1 file(s) with %2 job(s), failed: %3, total %4 ms\n")
+		.arg(files.size()).arg(m_options.jobs).arg(failed).arg(timer.elapsed());
+	m_out.flush();
+
+	return failed;
+}
+
+
+bool CBatchProcessor::processFile(const QString& fileName)
+{
+	QElapsedTimer timer;
+	QString lastError;
+	QString report = QFileInfo(fileName).fileName() + ":";
+
+	auto fail = [&](const QString& stage)
+	{
+		m_err << report << " " << stage << " failed";
+		if (lastError.size())
+			m_err << " (" << lastError << ")";
+		m_err << "\n";
+		m_err.flush();
+
+		return false;
+	};
+
+	CNodeEditorScene scene;
+
+	// load
+	timer.start();
+	if (!load(fileName, scene, lastError))
+		return fail("load");
+
+	report += QString(" load %1 ms").arg(timer.elapsed());
+
+	// layout
+	if (m_options.layout.size())
+	{
+		timer.start();
+		if (!layout(scene, lastError))
+			return fail("layout");
+
+		report += QString(", layout %1 ms").arg(timer.elapsed());
+	}
+
+	// save
+	QString outputName = outputFileName(fileName);
+
+	timer.start();
+	if (!save(outputName, scene, lastError))
+		return fail("save");
+
+	report += QString(", save %1 ms -> %2\n").arg(timer.elapsed()).arg(QDir::toNativeSeparators(outputName));
+
+	m_out << report;
+	m_out.flush();
+
+	return true;
+}
+
+
+bool CBatchProcessor::load(const QString& fileName, CNodeEditorScene& scene, QString& lastError) const
+{
+	QString format = QFileInfo(fileName).suffix().toLower();
+
+	if (format == "xgr")
+		return CFileSerializerXGR().load(fileName, scene, &lastError);
+
+	if (format == "graphml")
+		return CFileSerializerGraphML().load(fileName, scene, &lastError);
+
+	if (format == "gexf")
+		return CFileSerializerGEXF().load(fileName, scene, &lastError);
+
+	if (format == "dot" || format == "gv")
+		return CFileSerializerDOT().load(fileName, scene, &lastError);
+
+	if (format == "csv")
+	{
+		CFileSerializerCSV csvLoader;
+		if (m_options.csvDelimiter.toLower() == "tab")
+			csvLoader.setDelimiter('\t');
+		else if (m_options.csvDelimiter.size())
+			csvLoader.setDelimiter(m_options.csvDelimiter.at(0).toLatin1());
+
+		return csvLoader.load(fileName, scene, &lastError);
+	}
+
+	// else via ogdf
+#ifdef USE_OGDF
+	return COGDFLayout::loadGraph(fileName, scene, &lastError);
+#else
+	lastError = QObject::tr("Unsupported format: %1").arg(format);
+	return false;
+#endif
+}
+
+
+bool CBatchProcessor::layout(CNodeEditorScene& scene, QString& lastError) const
+{
+#ifdef USE_OGDF
+	const QString& name = m_options.layout;
+
+	if (name == "planar") {
+		ogdf::PlanarizationLayout layout;
+		COGDFLayout::doLayout(layout, scene);
+		return true;
+	}
+
+	if (name == "linear") {
+		ogdf::LinearLayout layout;
+		COGDFLayout::doLayout(layout, scene);
+		return true;
+	}
+
+	if (name == "balloon") {
+		ogdf::BalloonLayout layout;
+		COGDFLayout::doLayout(layout, scene);
+		return true;
+	}
+
+	if (name == "circular") {
+		ogdf::CircularLayout layout;
+		COGDFLayout::doLayout(layout, scene);
+		return true;
+	}
+
+	if (name == "fmmm") {
+		ogdf::FMMMLayout layout;
+		COGDFLayout::doLayout(layout, scene);
+		return true;
+	}
+
+	if (name == "sugiyama") {
+		ogdf::SugiyamaLayout layout;
+		COGDFLayout::doLayout(layout, scene);
+		return true;
+	}
+
+	lastError = QObject::tr("Unknown layout: %1").arg(name);
+	return false;
+#else
+	Q_UNUSED(scene);
+	lastError = QObject::tr("Layouts are not available (built without OGDF)");
+	return false;
+#endif
+}
+
+
+bool CBatchProcessor::save(const QString& fileName, CNodeEditorScene& scene, QString& lastError) const
+{
+	QString format = QFileInfo(fileName).suffix().toLower();
+
+	if (format == "xgr")
+		return CFileSerializerXGR().save(fileName, scene, &lastError);
+
+	if (format == "graphml")
+		return CFileSerializerGraphML().save(fileName, scene, &lastError);
+
+	if (format == "gexf")
+		return CFileSerializerGEXF().save(fileName, scene, &lastError);
+
+	if (format == "dot" || format == "gv")
+		return CFileSerializerDOT().save(fileName, scene, &lastError);
+
+	if (format == "pdf")
+		return CPDFExport().save(fileName, scene, &lastError);
+
+	if (format == "ppm" || format == "bmp" || QImageWriter::supportedImageFormats().contains(format.toLatin1()))
+		return CImageExport(m_options.dpi).save(fileName, scene, &lastError);
+
+	lastError = QObject::tr("Unsupported format: %1").arg(format);
+	return false;
+}
+
+
+QString CBatchProcessor::outputFileName(const QString& fileName) const
+{
+	QFileInfo fi(fileName);
+
+	QString dir = m_options.outputDir.isEmpty() ? fi.absolutePath() : m_options.outputDir;
+	QString format = m_options.format.isEmpty() ? fi.suffix() : m_options.format;
+
+	QString outputName = QDir(dir).absoluteFilePath(fi.completeBaseName() + "." + format);
+
+	// never overwrite the input
+	if (QFileInfo(outputName) == fi)
+	{
+		QString tag = m_options.layout.isEmpty() ? QString("out") : m_options.layout;
+		outputName = QDir(dir).absoluteFilePath(fi.completeBaseName() + "-" + tag + "." + format);
+	}
+
+	return outputName;
+}
@@ -0,0 +1,59 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+class CNodeEditorScene;
+
+
+struct CBatchOptions
+{
+	QString command;			// convert | layout | export
+	QString format;				// suffix of the output files (empty: same as input)
+	QString layout;				// layout to run before saving (empty: none)
+	QString outputDir;			// empty: next to the input files
+	QString csvDelimiter = ";";
+	int dpi = 96;				// image export
+	int jobs = 1;				// files processed at once
+};
+
+
+/**
+	Loads the graph files, runs layouts & writes the results without any UI.
+	Timings of every stage are printed to the standard output.
+*/
+class CBatchProcessor
+{
+public:
+	explicit CBatchProcessor(const CBatchOptions& options);
+
+	// processes the files one by one in this process; returns count of the failed files
+	int run(const QStringList& files);
+
+	// runs a child process per file (with childArgs + file name), options.jobs at once; returns count of the failed files
+	int runParallel(const QStringList& files, const QStringList& childArgs);
+
+	static QStringList layoutNames();
+
+private:
+	bool processFile(const QString& fileName);
+
+	bool load(const QString& fileName, CNodeEditorScene& scene, QString& lastError) const;
+	bool layout(CNodeEditorScene& scene, QString& lastError) const;
+	bool save(const QString& fileName, CNodeEditorScene& scene, QString& lastError) const;
+
+	QString outputFileName(const QString& fileName) const;
+
+	CBatchOptions m_options;
+	QTextStream m_out, m_err;
+};
@@ -0,0 +1,124 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#include <QtWidgets/QApplication>
+#include <QCommandLineParser>
+#include <QThread>
+#include <QTextStream>
+
+#include <cstdio>
+
+#include "CBatchProcessor.h"
+
+
+int main(int argc, char *argv[])
+{
+	// no windows are shown: offscreen platform unless given explicitly
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	QApplication a(argc, argv);
+	a.setApplicationName("qvge-cli");
+
+	QTextStream err(stderr);
+
+	// options
+	QCommandLineParser parser;
+	parser.setApplicationDescription(
+		"Batch processing of graph files.\n\n"
+		"Commands:\n"
+		"  convert  writes the files in another format (-f)\n"
+		"  layout   runs a layout (-l) and writes the files in the same or another format\n"
+		"  export   writes the files as images or PDF (-f, png by default)");
+	parser.addHelpOption();
+
+	parser.addPositionalArgument("command", "convert | layout | export");
+	parser.addPositionalArgument("files", "Graph files to process.", "files...");
+
+	QCommandLineOption formatOption(QStringList() << "f" << "format",
+		"Output format: xgr, graphml, gexf, dot, gv, pdf or an image format.", "format");
+	QCommandLineOption layoutOption(QStringList() << "l" << "layout",
+		"Layout to run: " + CBatchProcessor::layoutNames().join(", ") + ".", "layout");
+	QCommandLineOption outputOption(QStringList() << "o" << "output-dir",
+		"Directory of the output files (next to the input files by default).", "dir");
+	QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+		"Count of the files processed at once (count of the cores by default).", "count",
+		QString::number(QThread::idealThreadCount()));
+	QCommandLineOption dpiOption("dpi", "Resolution of the exported images.", "dpi", "96");
+	QCommandLineOption csvOption("csv-delimiter", "Delimiter of CSV columns: a character or 'tab'.", "delimiter", ";");
+
+	parser.addOption(formatOption);
+	parser.addOption(layoutOption);
+	parser.addOption(outputOption);
+	parser.addOption(jobsOption);
+	parser.addOption(dpiOption);
+	parser.addOption(csvOption);
+
+	parser.process(a);
+
+	QStringList args = parser.positionalArguments();
+	if (args.size() < 2)
+		parser.showHelp(1);
+
+	CBatchOptions options;
+	options.command = args.takeFirst();
+	options.format = parser.value(formatOption);
+	options.layout = parser.value(layoutOption);
+	options.outputDir = parser.value(outputOption);
+	options.csvDelimiter = parser.value(csvOption);
+	options.dpi = qMax(1, parser.value(dpiOption).toInt());
+	options.jobs = qMax(1, parser.value(jobsOption).toInt());
+
+	if (options.command == "convert")
+	{
+		if (options.format.isEmpty())
+		{
+			err << "convert: output format (-f) is required\n";
+			return 1;
+		}
+	}
+	else if (options.command == "layout")
+	{
+		if (options.layout.isEmpty())
+		{
+			err << "layout: layout (-l) is required\n";
+			return 1;
+		}
+	}
+	else if (options.command == "export")
+	{
+		if (options.format.isEmpty())
+			options.format = "png";
+	}
+	else
+	{
+		err << "Unknown command: " << options.command << "\n";
+		return 1;
+	}
+
+	CBatchProcessor processor(options);
+
+	// single file or job: here
+	if (args.size() == 1 || options.jobs == 1)
+		return processor.run(args) ? 2 : 0;
+
+	// else a process per file (the scenes are not thread-safe)
+	QStringList childArgs;
+	childArgs << options.command << "-j" << "1";
+	childArgs << "--dpi" << QString::number(options.dpi);
+	childArgs << "--csv-delimiter" << options.csvDelimiter;
+	if (options.format.size())
+		childArgs << "-f" << options.format;
+	if (options.layout.size())
+		childArgs << "-l" << options.layout;
+	if (options.outputDir.size())
+		childArgs << "-o" << options.outputDir;
+
+	return processor.runParallel(args, childArgs) ? 2 : 0;
+}
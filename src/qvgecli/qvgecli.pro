@@ -0,0 +1,59 @@
+# This file is a part of
+# QVGE - Qt Visual Graph Editor
+#
+# (c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+#
+# It can be used freely, maintaining the information above.
+
+
+TEMPLATE = app
+TARGET = qvge-cli
+
+CONFIG += console
+CONFIG -= app_bundle
+
+
+include(../config.pri)
+
+
+# app sources
+SOURCES += $$files($$PWD/*.cpp)
+HEADERS += $$files($$PWD/*.h)
+
+
+# includes & libs
+INCLUDEPATH += $$PWD $$PWD/..
+
+CONFIG(debug, debug|release){
+        DESTDIR = $$OUT_PWD/../bin.debug
+        LIBS += -L$$OUT_PWD/../lib.debug
+}
+else{
+        DESTDIR = $$OUT_PWD/../bin
+        LIBS += -L$$OUT_PWD/../lib
+}
+
+LIBS += -lqvge -lqvgeio
+
+USE_OGDF{
+    INCLUDEPATH += $$PWD/../3rdParty/ogdf/include
+
+    # layouts are taken without the rest of commonui (no widgets)
+    SOURCES += $$PWD/../commonui/ogdf/COGDFLayout.cpp
+    HEADERS += $$PWD/../commonui/ogdf/COGDFLayout.h
+
+    LIBS += -logdf
+}
+
+win32{
+    LIBS += -lopengl32 -lglu32 -lshell32 -luser32 -lpsapi
+}
+
+cygwin*{
+    LIBS += -lopengl32 -lglu32 -lshell32 -luser32 -lpsapi
+}
+
+
+# install
+target.path = /usr/local/bin
+INSTALLS += target
@@ -0,0 +1,1146 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#include "CFormatDOT.h"
+
+#include <QFile>
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QVector>
+#include <QSizeF>
+#include <QStringList>
+
+
+// size of the blocks the file is read by
+static const qint64 s_blockSize = 1024 * 1024;
+
+
+namespace
+{
+
+// tokenizer
+
+enum DOTTokenType
+{
+	DT_End,
+	DT_Error,
+	DT_Id,
+	DT_LBrace, DT_RBrace,
+	DT_LBracket, DT_RBracket,
+	DT_Equal, DT_Semicolon, DT_Comma, DT_Colon, DT_Plus,
+	DT_EdgeOp
+};
+
+
+struct DOTToken
+{
+	DOTTokenType type = DT_End;
+	QByteArray text;
+	bool quoted = false;	// quoted & HTML strings are never keywords
+	int line = 0;
+};
+
+
+class CDOTTokenizer
+{
+public:
+	CDOTTokenizer(QIODevice& device, IProgressMonitor* monitor) :
+		m_device(device),
+		m_monitor(monitor),
+		m_total(device.size())
+	{}
+
+	DOTToken next();
+
+	bool isCancelled() const		{ return m_cancelled; }
+	const QString& errorString() const	{ return m_error; }
+
+private:
+	// returns the char at offset from the current position or -1 at the end
+	int peek(int offset = 0);
+	int get();
+	bool fill(int offset);
+
+	void skipSpacesAndComments();
+	bool readQuoted(DOTToken& token);
+	bool readHtml(DOTToken& token);
+	bool readName(DOTToken& token);
+
+	static bool isNameChar(int c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+			c == '_' || c == '.' || c >= 0x80;
+	}
+
+	QIODevice& m_device;
+	IProgressMonitor* m_monitor = nullptr;
+	qint64 m_total = 0;
+
+	QByteArray m_buffer;
+	int m_pos = 0;
+	int m_line = 1;
+	bool m_lineStart = true;
+	bool m_cancelled = false;
+	QString m_error;
+};
+
+
+bool CDOTTokenizer::fill(int offset)
+{
+	while (m_pos + offset >= m_buffer.size())
+	{
+		if (m_cancelled || m_device.atEnd())
+			return false;
+
+		// keep the unread tail only
+		m_buffer = m_buffer.mid(m_pos) + m_device.read(s_blockSize);
+		m_pos = 0;
+
+		if (m_monitor && !m_monitor->onProgress(m_device.pos(), m_total))
+		{
+			m_cancelled = true;
+			m_buffer.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+int CDOTTokenizer::peek(int offset)
+{
+	if (m_pos + offset >= m_buffer.size() && !fill(offset))
+		return -1;
+
+	return (uchar) m_buffer.at(m_pos + offset);
+}
+
+
+int CDOTTokenizer::get()
+{
+	int c = peek();
+	if (c < 0)
+		return c;
+
+	m_pos++;
+
+	if (c == '\n')
+	{
+		m_line++;
+		m_lineStart = true;
+	}
+
+	return c;
+}
+
+
+void CDOTTokenizer::skipSpacesAndComments()
+{
+	for (;;)
+	{
+		int c = peek();
+
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v')
+		{
+			get();
+			continue;
+		}
+
+		// lines of C preprocessor output
+		if (c == '#' && m_lineStart)
+		{
+			while ((c = get()) >= 0 && c != '\n');
+			continue;
+		}
+
+		if (c == '/' && peek(1) == '/')
+		{
+			while ((c = get()) >= 0 && c != '\n');
+			continue;
+		}
+
+		if (c == '/' && peek(1) == '*')
+		{
+			get(); get();
+
+			while ((c = get()) >= 0)
+			{
+				if (c == '*' && peek() == '/')
+				{
+					get();
+					break;
+				}
+			}
+			continue;
+		}
+
+		return;
+	}
+}
+
+
+DOTToken CDOTTokenizer::next()
+{
+	skipSpacesAndComments();
+
+	DOTToken token;
+	token.line = m_line;
+	m_lineStart = false;
+
+	int c = peek();
+	switch (c)
+	{
+	case -1:	token.type = DT_End;		return token;
+	case '{':	token.type = DT_LBrace;		break;
+	case '}':	token.type = DT_RBrace;		break;
+	case '[':	token.type = DT_LBracket;	break;
+	case ']':	token.type = DT_RBracket;	break;
+	case '=':	token.type = DT_Equal;		break;
+	case ';':	token.type = DT_Semicolon;	break;
+	case ',':	token.type = DT_Comma;		break;
+	case ':':	token.type = DT_Colon;		break;
+	case '+':	token.type = DT_Plus;		break;
+
+	case '"':
+		if (!readQuoted(token))
+			token.type = DT_Error;
+		return token;
+
+	case '<':
+		if (!readHtml(token))
+			token.type = DT_Error;
+		return token;
+
+	case '-':
+		if (peek(1) == '>' || peek(1) == '-')
+		{
+			get(); get();
+			token.type = DT_EdgeOp;
+			return token;
+		}
+		// else a negative numeral
+		// fall through
+
+	default:
+		if (!readName(token))
+			token.type = DT_Error;
+		return token;
+	}
+
+	get();
+	return token;
+}
+
+
+bool CDOTTokenizer::readQuoted(DOTToken& token)
+{
+	get();	// "
+
+	for (;;)
+	{
+		int c = get();
+		if (c < 0)
+		{
+			m_error = QObject::tr("Unterminated string");
+			return false;
+		}
+
+		if (c == '"')
+			break;
+
+		if (c == '\\')
+		{
+			int n = peek();
+
+			// escaped quote
+			if (n == '"')
+			{
+				token.text += char(get());
+				continue;
+			}
+
+			// line continuation
+			if (n == '\n')
+			{
+				get();
+				continue;
+			}
+
+			if (n == '\r' && peek(1) == '\n')
+			{
+				get(); get();
+				continue;
+			}
+
+			// other escapes (\n, \l, \N...) are kept as they are
+		}
+
+		token.text += char(c);
+	}
+
+	token.type = DT_Id;
+	token.quoted = true;
+	return true;
+}
+
+
+bool CDOTTokenizer::readHtml(DOTToken& token)
+{
+	get();	// <
+
+	int depth = 1;
+	for (;;)
+	{
+		int c = get();
+		if (c < 0)
+		{
+			m_error = QObject::tr("Unterminated HTML string");
+			return false;
+		}
+
+		if (c == '<')
+			depth++;
+		else if (c == '>' && --depth == 0)
+			break;
+
+		token.text += char(c);
+	}
+
+	token.type = DT_Id;
+	token.quoted = true;
+	return true;
+}
+
+
+bool CDOTTokenizer::readName(DOTToken& token)
+{
+	if (peek() == '-')
+		token.text += char(get());
+
+	while (isNameChar(peek()))
+		token.text += char(get());
+
+	if (token.text.isEmpty() || token.text == "-")
+	{
+		m_error = QObject::tr("Unexpected character '%1'").arg(QChar(peek()));
+		return false;
+	}
+
+	token.type = DT_Id;
+	return true;
+}
+
+
+// parser: builds the graph with raw DOT attributes
+
+class CDOTParser
+{
+public:
+	CDOTParser(CDOTTokenizer& tokenizer, Graph& graph) :
+		m_tokenizer(tokenizer),
+		m_graph(graph)
+	{}
+
+	bool parse();
+
+	const QString& errorString() const			{ return m_error; }
+	bool isDirected() const						{ return m_directed; }
+
+	// defaults set at the top level
+	const GraphAttributes& nodeDefaults() const	{ return m_nodeDefaults; }
+	const GraphAttributes& edgeDefaults() const	{ return m_edgeDefaults; }
+
+private:
+	struct Scope
+	{
+		GraphAttributes nodeDefaults;
+		GraphAttributes edgeDefaults;
+		QVector<int> nodes;		// nodes mentioned inside of a subgraph
+	};
+
+	struct EdgeEnd
+	{
+		QVector<int> nodes;
+		QByteArray port;
+	};
+
+	const DOTToken& peekToken();
+	DOTToken takeToken();
+
+	bool expect(DOTTokenType type, const char* text);
+	bool unexpected(const DOTToken& token);
+
+	bool parseStatements(Scope& scope, int depth);
+	bool parseStatement(Scope& scope, int depth);
+	bool parseSubgraph(Scope& parent, int depth, QVector<int>& nodes);
+	bool parseEdges(Scope& scope, int depth, const EdgeEnd& first);
+	bool parseAttrList(GraphAttributes& attrs);
+	bool parseId(QByteArray& id);
+	bool parsePort(QByteArray& port);
+
+	int ensureNode(const QByteArray& id, Scope& scope, int depth);
+	void addPort(int nodeIndex, const QByteArray& port);
+	void addEdge(int start, const QByteArray& startPort, int end, const QByteArray& endPort, const GraphAttributes& attrs);
+
+	static bool isKeyword(const DOTToken& token, const char* keyword)
+	{
+		return token.type == DT_Id && !token.quoted && token.text.toLower() == keyword;
+	}
+
+	CDOTTokenizer& m_tokenizer;
+	Graph& m_graph;
+
+	DOTToken m_token;
+	bool m_hasToken = false;
+
+	bool m_directed = true;
+	bool m_strict = false;
+
+	GraphAttributes m_nodeDefaults, m_edgeDefaults;
+	QHash<QByteArray, int> m_nodeIndex;
+	QSet<QPair<int, int>> m_edgeSet;	// for strict graphs only
+
+	QString m_error;
+};
+
+
+const DOTToken& CDOTParser::peekToken()
+{
+	if (!m_hasToken)
+	{
+		m_token = m_tokenizer.next();
+		m_hasToken = true;
+	}
+
+	return m_token;
+}
+
+
+DOTToken CDOTParser::takeToken()
+{
+	peekToken();
+	m_hasToken = false;
+	return m_token;
+}
+
+
+bool CDOTParser::expect(DOTTokenType type, const char* text)
+{
+	DOTToken token = takeToken();
+	if (token.type == type)
+		return true;
+
+	if (token.type == DT_End || token.type == DT_Error)
+		return unexpected(token);
+
+	m_error = QObject::tr("'%1' expected\nline: %2").arg(text).arg(token.line);
+	return false;
+}
+
+
+bool CDOTParser::unexpected(const DOTToken& token)
+{
+	if (token.type == DT_Error)
+		m_error = QObject::tr("%1\nline: %2").arg(m_tokenizer.errorString()).arg(token.line);
+	else if (token.type == DT_End)
+		m_error = QObject::tr("Unexpected end of file");
+	else
+		m_error = QObject::tr("Unexpected '%1'\nline: %2").arg(QString::fromUtf8(token.text)).arg(token.line);
+
+	return false;
+}
+
+
+bool CDOTParser::parse()
+{
+	DOTToken token = takeToken();
+
+	if (isKeyword(token, "strict"))
+	{
+		m_strict = true;
+		token = takeToken();
+	}
+
+	if (isKeyword(token, "digraph"))
+		m_directed = true;
+	else if (isKeyword(token, "graph"))
+		m_directed = false;
+	else
+	{
+		if (token.type == DT_End || token.type == DT_Error)
+			return unexpected(token);
+
+		m_error = QObject::tr("'graph' or 'digraph' expected\nline: %1").arg(token.line);
+		return false;
+	}
+
+	// name of the graph is not used
+	if (peekToken().type == DT_Id)
+	{
+		QByteArray name;
+		if (!parseId(name))
+			return false;
+	}
+
+	if (!expect(DT_LBrace, "{"))
+		return false;
+
+	Scope scope;
+	if (!parseStatements(scope, 0))
+		return false;
+
+	// the rest of the file (other graphs) is ignored
+	return expect(DT_RBrace, "}");
+}
+
+
+bool CDOTParser::parseStatements(Scope& scope, int depth)
+{
+	for (;;)
+	{
+		const DOTToken& token = peekToken();
+
+		if (token.type == DT_RBrace)
+			return true;
+
+		if (token.type == DT_Semicolon)
+		{
+			takeToken();
+			continue;
+		}
+
+		if (!parseStatement(scope, depth))
+			return false;
+	}
+}
+
+
+bool CDOTParser::parseStatement(Scope& scope, int depth)
+{
+	DOTToken token = peekToken();
+
+	// subgraph, maybe followed by edges
+	if (token.type == DT_LBrace || isKeyword(token, "subgraph"))
+	{
+		EdgeEnd first;
+		if (!parseSubgraph(scope, depth, first.nodes))
+			return false;
+
+		if (peekToken().type == DT_EdgeOp)
+			return parseEdges(scope, depth, first);
+
+		return true;
+	}
+
+	if (token.type != DT_Id)
+		return unexpected(takeToken());
+
+	// default attributes
+	bool isGraph = isKeyword(token, "graph");
+	bool isNode = isKeyword(token, "node");
+	bool isEdge = isKeyword(token, "edge");
+
+	if (isGraph || isNode || isEdge)
+	{
+		takeToken();
+
+		GraphAttributes attrs;
+		if (!parseAttrList(attrs))
+			return false;
+
+		// top level defaults become class attributes, the ones of subgraphs are assigned to their items;
+		// attributes of subgraphs themselves have no meaning here
+		if (isGraph && depth > 0)
+			return true;
+
+		GraphAttributes& defaults =
+			isGraph ? m_graph.attrs :
+			(depth == 0) ?
+				(isNode ? m_nodeDefaults : m_edgeDefaults) :
+				(isNode ? scope.nodeDefaults : scope.edgeDefaults);
+
+		for (auto it = attrs.constBegin(); it != attrs.constEnd(); ++it)
+			defaults[it.key()] = it.value();
+
+		return true;
+	}
+
+	QByteArray id;
+	if (!parseId(id))
+		return false;
+
+	// ID = ID
+	if (peekToken().type == DT_Equal)
+	{
+		takeToken();
+
+		QByteArray value;
+		if (!parseId(value))
+			return false;
+
+		if (depth == 0)
+			m_graph.attrs[id] = QString::fromUtf8(value);
+
+		return true;
+	}
+
+	EdgeEnd first;
+	if (!parsePort(first.port))
+		return false;
+
+	int nodeIndex = ensureNode(id, scope, depth);
+	first.nodes.append(nodeIndex);
+
+	if (peekToken().type == DT_EdgeOp)
+		return parseEdges(scope, depth, first);
+
+	// node statement
+	GraphAttributes attrs;
+	if (!parseAttrList(attrs))
+		return false;
+
+	addPort(nodeIndex, first.port);
+
+	GraphAttributes& nodeAttrs = m_graph.nodes[nodeIndex].attrs;
+	for (auto it = attrs.constBegin(); it != attrs.constEnd(); ++it)
+		nodeAttrs[it.key()] = it.value();
+
+	return true;
+}
+
+
+bool CDOTParser::parseSubgraph(Scope& parent, int depth, QVector<int>& nodes)
+{
+	if (isKeyword(peekToken(), "subgraph"))
+	{
+		takeToken();
+
+		// name of the subgraph is not used
+		if (peekToken().type == DT_Id)
+		{
+			QByteArray name;
+			if (!parseId(name))
+				return false;
+		}
+	}
+
+	if (!expect(DT_LBrace, "{"))
+		return false;
+
+	Scope scope;
+	scope.nodeDefaults = parent.nodeDefaults;
+	scope.edgeDefaults = parent.edgeDefaults;
+
+	if (!parseStatements(scope, depth + 1))
+		return false;
+
+	if (!expect(DT_RBrace, "}"))
+		return false;
+
+	// every node once
+	QSet<int> usedNodes;
+	for (int nodeIndex : scope.nodes)
+	{
+		if (!usedNodes.contains(nodeIndex))
+		{
+			usedNodes.insert(nodeIndex);
+			nodes.append(nodeIndex);
+		}
+	}
+
+	// nested subgraphs belong to the parent one as well
+	if (depth > 0)
+		parent.nodes += nodes;
+
+	return true;
+}
+
+
+bool CDOTParser::parseEdges(Scope& scope, int depth, const EdgeEnd& first)
+{
+	QVector<EdgeEnd> ends;
+	ends.append(first);
+
+	while (peekToken().type == DT_EdgeOp)
+	{
+		takeToken();
+
+		EdgeEnd end;
+
+		const DOTToken& token = peekToken();
+		if (token.type == DT_LBrace || isKeyword(token, "subgraph"))
+		{
+			if (!parseSubgraph(scope, depth, end.nodes))
+				return false;
+		}
+		else
+		{
+			QByteArray id;
+			if (!parseId(id))
+				return false;
+
+			if (!parsePort(end.port))
+				return false;
+
+			end.nodes.append(ensureNode(id, scope, depth));
+		}
+
+		ends.append(end);
+	}
+
+	GraphAttributes attrs = scope.edgeDefaults;
+	if (!parseAttrList(attrs))
+		return false;
+
+	// a -> b -> c: a -> b, b -> c; subgraphs connect all their nodes
+	for (int i = 1; i < ends.size(); ++i)
+	{
+		const EdgeEnd& start = ends.at(i - 1);
+		const EdgeEnd& end = ends.at(i);
+
+		for (int startIndex : start.nodes)
+			for (int endIndex : end.nodes)
+				addEdge(startIndex, start.port, endIndex, end.port, attrs);
+	}
+
+	return true;
+}
+
+
+bool CDOTParser::parseAttrList(GraphAttributes& attrs)
+{
+	while (peekToken().type == DT_LBracket)
+	{
+		takeToken();
+
+		while (peekToken().type != DT_RBracket)
+		{
+			QByteArray name, value("true");
+			if (!parseId(name))
+				return false;
+
+			// 'name' alone is a flag
+			if (peekToken().type == DT_Equal)
+			{
+				takeToken();
+
+				if (!parseId(value))
+					return false;
+			}
+
+			attrs[name] = QString::fromUtf8(value);
+
+			DOTTokenType type = peekToken().type;
+			if (type == DT_Comma || type == DT_Semicolon)
+				takeToken();
+		}
+
+		takeToken();	// ]
+	}
+
+	return true;
+}
+
+
+bool CDOTParser::parseId(QByteArray& id)
+{
+	DOTToken token = takeToken();
+	if (token.type != DT_Id)
+		return unexpected(token);
+
+	id = token.text;
+
+	// "a" + "b"
+	while (token.quoted && peekToken().type == DT_Plus)
+	{
+		takeToken();
+
+		token = takeToken();
+		if (token.type != DT_Id || !token.quoted)
+			return unexpected(token);
+
+		id += token.text;
+	}
+
+	return true;
+}
+
+
+bool CDOTParser::parsePort(QByteArray& port)
+{
+	if (peekToken().type != DT_Colon)
+		return true;
+
+	takeToken();
+	if (!parseId(port))
+		return false;
+
+	// node:port:compass_pt
+	if (peekToken().type == DT_Colon)
+	{
+		takeToken();
+
+		QByteArray compassPoint;
+		if (!parseId(compassPoint))
+			return false;
+	}
+
+	// a compass point alone is not a port
+	static const QSet<QByteArray> compassPoints = { "n", "ne", "e", "se", "s", "sw", "w", "nw", "c", "_" };
+	if (compassPoints.contains(port))
+		port.clear();
+
+	return true;
+}
+
+
+int CDOTParser::ensureNode(const QByteArray& id, Scope& scope, int depth)
+{
+	int nodeIndex;
+
+	auto it = m_nodeIndex.constFind(id);
+	if (it == m_nodeIndex.constEnd())
+	{
+		// defaults are applied to the new nodes only
+		Node node;
+		node.id = id;
+		node.attrs = scope.nodeDefaults;
+
+		nodeIndex = m_graph.nodes.size();
+		m_graph.nodes.append(node);
+		m_nodeIndex[id] = nodeIndex;
+	}
+	else
+		nodeIndex = it.value();
+
+	if (depth > 0)
+		scope.nodes.append(nodeIndex);
+
+	return nodeIndex;
+}
+
+
+void CDOTParser::addPort(int nodeIndex, const QByteArray& port)
+{
+	if (port.isEmpty())
+		return;
+
+	QString portName = QString::fromUtf8(port);
+
+	NodePorts& ports = m_graph.nodes[nodeIndex].ports;
+	if (!ports.contains(portName))
+	{
+		NodePort nodePort;
+		nodePort.name = portName;
+		ports[portName] = nodePort;
+	}
+}
+
+
+void CDOTParser::addEdge(int start, const QByteArray& startPort, int end, const QByteArray& endPort, const GraphAttributes& attrs)
+{
+	// strict graphs have no multi-edges
+	if (m_strict)
+	{
+		auto key = (m_directed || start <= end) ? qMakePair(start, end) : qMakePair(end, start);
+		if (m_edgeSet.contains(key))
+			return;
+
+		m_edgeSet.insert(key);
+	}
+
+	addPort(start, startPort);
+	addPort(end, endPort);
+
+	Edge edge;
+	edge.attrs = attrs;
+	edge.id = edge.attrs.take("id").toString().toUtf8();
+	edge.startNodeId = m_graph.nodes.at(start).id;
+	edge.startPortId = startPort;
+	edge.endNodeId = m_graph.nodes.at(end).id;
+	edge.endPortId = endPort;
+
+	m_graph.edges.append(edge);
+}
+
+}	// namespace
+
+
+// helpers
+
+static QString fromDotShape(const QString& shape)
+{
+	// rename to conform qvge
+	if (shape == "ellipse" || shape == "oval" || shape == "circle")
+		return "disc";
+
+	if (shape == "rect" || shape == "box" || shape == "rectangle" || shape == "square")
+		return "square";
+
+	if (shape == "invtriangle")
+		return "triangle2";
+
+	// else take original
+	return shape;
+}
+
+
+static void takeLabel(GraphAttributes& attrs)
+{
+	// CFileSerializerDOT writes xlabel, the others mostly label
+	QString label = attrs.take("label").toString();
+	QString xlabel = attrs.take("xlabel").toString();
+
+	// \N: name of the node, which is the default
+	if (label == "\\N")
+		label.clear();
+
+	if (xlabel.size())
+		attrs["label"] = xlabel;
+	else if (label.size())
+		attrs["label"] = label;
+
+	if (attrs.contains("fontcolor"))
+		attrs["label.color"] = attrs.take("fontcolor");
+}
+
+
+// reimp
+
+bool CFormatDOT::load(const QString& fileName, Graph& graph, QString* lastError, IProgressMonitor* monitor) const
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		if (lastError)
+			*lastError = file.errorString();
+
+		return false;
+	}
+
+	graph.clear();
+
+	CDOTTokenizer tokenizer(file, monitor);
+	CDOTParser parser(tokenizer, graph);
+
+	bool ok = parser.parse();
+
+	if (tokenizer.isCancelled())
+	{
+		graph.clear();
+
+		if (lastError)
+			*lastError = QObject::tr("Cancelled");
+
+		return false;
+	}
+
+	if (!ok)
+	{
+		graph.clear();
+
+		if (lastError)
+			*lastError = parser.errorString();
+
+		return false;
+	}
+
+	// convert the attributes
+	// positions are converted to points, so the scale is not kept
+	double inputScale = 0;
+	if (graph.attrs.contains("inputscale"))
+		inputScale = graph.attrs.take("inputscale").toDouble();
+
+	// files of the older qvge versions have no inputscale and store pos in inches
+	bool legacyInches = (inputScale <= 0 && parser.nodeDefaults().value("class").toString() == "node");
+
+	for (auto& node : graph.nodes)
+		convertNode(node, inputScale, legacyInches);
+
+	for (auto& edge : graph.edges)
+		convertEdge(edge);
+
+	convertClassAttrs(parser.nodeDefaults(), true, graph.nodeAttrs);
+	convertClassAttrs(parser.edgeDefaults(), false, graph.edgeAttrs);
+
+	if (!parser.isDirected() && !graph.edgeAttrs.contains("direction"))
+	{
+		AttrInfo attr;
+		attr.id = "direction";
+		attr.name = "direction";
+		attr.valueType = QMetaType::QString;
+		attr.defaultValue = QString("undirected");
+		graph.edgeAttrs[attr.id] = attr;
+	}
+
+	if (monitor)
+		monitor->onProgress(file.size(), file.size());
+
+	return true;
+}
+
+
+void CFormatDOT::convertNode(Node& node, double inputScale, bool legacyInches) const
+{
+	GraphAttributes& attrs = node.attrs;
+
+	// "x,y" or "x,y!" ('!' means pinned): in 1/inputscale inches if the graph sets it;
+	// else in inches if written by the older qvge (or pinned, as they were read before), in points otherwise
+	if (attrs.contains("pos"))
+	{
+		QString pos = attrs["pos"].toString().trimmed();
+		double scale = (inputScale > 0) ? 72.0 / inputScale :
+			(legacyInches || pos.endsWith('!')) ? 72.0 : 1.0;
+
+		pos.remove('!');
+		QStringList xy = pos.split(',');
+
+		bool okX = false, okY = false;
+		double x = xy.first().toDouble(&okX);
+		double y = xy.size() > 1 ? xy.at(1).toDouble(&okY) : 0;
+
+		if (okX && okY)
+		{
+			attrs["x"] = x * scale;
+			attrs["y"] = -y * scale;	// y goes up in DOT
+			attrs.remove("pos");
+		}
+	}
+
+	// inches -> points
+	bool okW = false, okH = false;
+	double w = attrs.value("width").toDouble(&okW);
+	double h = attrs.value("height").toDouble(&okH);
+	if (okW || okH)
+	{
+		if (!okW) w = h;
+		if (!okH) h = w;
+
+		attrs["size"] = QSizeF(w * 72.0, h * 72.0);
+		attrs.remove("width");
+		attrs.remove("height");
+	}
+
+	// fillcolor is the color of the node, color is the one of its outline (and fill if no fillcolor)
+	QStringList styles = attrs.take("style").toString().split(',', QString::SkipEmptyParts);
+	for (auto& style : styles)
+		style = style.trimmed();
+
+	bool filled = styles.removeAll("filled") > 0;
+
+	QVariant fillColor = attrs.take("fillcolor");
+	QVariant dotColor = attrs.take("color");
+
+	if (fillColor.isValid())
+		attrs["color"] = fillColor;
+	else if (filled && dotColor.isValid())
+		attrs["color"] = dotColor;
+
+	if (dotColor.isValid())
+		attrs["stroke.color"] = dotColor;
+
+	for (int i = 0; i < styles.size(); ++i)
+	{
+		const QString& style = styles.at(i);
+		if (style == "solid" || style == "dashed" || style == "dotted")
+		{
+			attrs["stroke.style"] = style;
+			styles.removeAt(i);
+			break;
+		}
+	}
+
+	if (styles.size())
+		attrs["style"] = styles.join(',');
+
+	if (attrs.contains("penwidth"))
+		attrs["stroke.size"] = attrs.take("penwidth").toDouble();
+
+	if (attrs.contains("shape"))
+		attrs["shape"] = fromDotShape(attrs["shape"].toString());
+
+	takeLabel(attrs);
+}
+
+
+void CFormatDOT::convertEdge(Edge& edge) const
+{
+	GraphAttributes& attrs = edge.attrs;
+
+	if (attrs.contains("dir"))
+	{
+		QString dir = attrs.take("dir").toString();
+
+		if (dir == "both")
+			attrs["direction"] = "mutual";
+		else if (dir == "none")
+			attrs["direction"] = "undirected";
+		else
+		{
+			attrs["direction"] = "directed";
+
+			// arrow at the start
+			if (dir == "back")
+			{
+				qSwap(edge.startNodeId, edge.endNodeId);
+				qSwap(edge.startPortId, edge.endPortId);
+			}
+		}
+	}
+
+	// CFileSerializerDOT writes the weight as both
+	if (attrs.contains("penwidth"))
+	{
+		QVariant penWidth = attrs.take("penwidth");
+		if (!attrs.contains("weight"))
+			attrs["weight"] = penWidth.toDouble();
+	}
+	else if (attrs.contains("weight"))
+		attrs["weight"] = attrs["weight"].toDouble();
+
+	takeLabel(attrs);
+}
+
+
+void CFormatDOT::convertClassAttrs(const GraphAttributes& attrs, bool isNode, AttributeInfos& attrInfos) const
+{
+	GraphAttributes classAttrs;
+
+	if (isNode)
+	{
+		Node node;
+		node.attrs = attrs;
+		convertNode(node, 0);
+		classAttrs = node.attrs;
+	}
+	else
+	{
+		Edge edge;
+		edge.attrs = attrs;
+		convertEdge(edge);
+		classAttrs = edge.attrs;
+	}
+
+	// written by CFileSerializerDOT for its own needs
+	classAttrs.remove("class");
+	classAttrs.remove("_vis_");
+
+	for (auto it = classAttrs.constBegin(); it != classAttrs.constEnd(); ++it)
+	{
+		AttrInfo attr;
+		attr.id = it.key();
+		attr.name = QString::fromUtf8(it.key());
+		attr.valueType = it.value().type();
+		attr.defaultValue = it.value();
+		attrInfos[attr.id] = attr;
+	}
+}
@@ -0,0 +1,37 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QMap>
+#include <QByteArray>
+#include <QVariant>
+
+#include <qvgeio/CGraphBase.h>
+#include <qvgeio/IProgressMonitor.h>
+
+
+/**
+	Reader of DOT/GraphViz graphs (*.gv, *.dot).
+
+	The file is tokenized by blocks, so it is never kept in memory as a whole.
+	Subgraphs are flattened. Known DOT attributes are converted into QVGE ones
+	(the opposite of CFileSerializerDOT), the rest are kept as they are.
+*/
+class CFormatDOT
+{
+public:
+	bool load(const QString& fileName, Graph& graph, QString* lastError = nullptr, IProgressMonitor* monitor = nullptr) const;
+
+private:
+	// inputScale <= 0: not given by the graph
+	void convertNode(Node& node, double inputScale, bool legacyInches = false) const;
+	void convertEdge(Edge& edge) const;
+	void convertClassAttrs(const GraphAttributes& attrs, bool isNode, AttributeInfos& attrInfos) const;
+};
@@ -142,71 +142,96 @@ void CFormatGraphML::writeAttributes(QXmlStreamWriter &xsw, const AttributeInfos
 }
 
 
-bool CFormatGraphML::load(const QString& fileName, Graph& graph, QString* lastError) const
+bool CFormatGraphML::load(const QString& fileName, Graph& graph, QString* lastError, IProgressMonitor* monitor) const
 {
-	// read file into document
+	// read file in one pass
 	QFile file(fileName);
 	if (!file.open(QIODevice::ReadOnly))
 		return false;
 
-	QString errorString;
-	int errorLine, errorColumn;
-
-	QDomDocument doc("graphml");
-	if (!doc.setContent(&file, false, &errorString, &errorLine, &errorColumn))
-	{
-		file.close();
+	graph.clear();
 
-		if (lastError)
-			*lastError = QObject::tr("%1\nline: %2, column: %3").arg(errorString).arg(errorLine).arg(errorColumn);
+	m_edgeType = "undirected";
+	bool graphFound = false;
 
-		return false;
-	}
+	KeyAttrMap cka;
+	int keyIndex = 0, nodeIndex = 0, edgeIndex = 0;
 
-	file.close();
+	const qint64 fileSize = file.size();
+	int elementCount = 0;
 
-	// try to parse
-	graph.clear();
+	QXmlStreamReader xsr(&file);
 
-	QDomNodeList tree = doc.elementsByTagName("graph");
-	if (tree.count())
+	while (!xsr.atEnd())
 	{
-		m_edgeType = tree.at(0).toElement().attribute("edgedefault", "undirected");
-	}
+		if (xsr.readNext() != QXmlStreamReader::StartElement)
+			continue;
 
-	KeyAttrMap cka;
+		auto name = xsr.name();
 
-	QDomNodeList keys = doc.elementsByTagName("key");
-	for (int i = 0; i < keys.count(); ++i)
-	{
-		readAttrKey(i, keys.at(i), graph, cka);
-	}
+		if (name == "key")
+		{
+			readAttrKey(keyIndex++, xsr, graph, cka);
+		}
+		else if (name == "node")
+		{
+			readNode(nodeIndex++, xsr, graph, cka);
+		}
+		else if (name == "edge")
+		{
+			readEdge(edgeIndex++, xsr, graph, cka);
+		}
+		else if (name == "graph" && !graphFound)
+		{
+			graphFound = true;
 
-	QDomNodeList nodes = doc.elementsByTagName("node");
-	for (int i = 0; i < nodes.count(); ++i)
-	{
-		readNode(i, nodes.at(i), graph, cka);
+			auto edgeDefault = xsr.attributes().value("edgedefault");
+			if (!edgeDefault.isEmpty())
+				m_edgeType = edgeDefault.toString();
+		}
+
+		// progress
+		if (monitor && (++elementCount % 1000) == 0)
+		{
+			if (!monitor->onProgress(file.pos(), fileSize))
+			{
+				graph.clear();
+
+				if (lastError)
+					*lastError = QObject::tr("Cancelled");
+
+				return false;
+			}
+		}
 	}
 
-	QDomNodeList edges = doc.elementsByTagName("edge");
-	for (int i = 0; i < edges.count(); ++i)
+	if (xsr.hasError())
 	{
-		readEdge(i, edges.at(i), graph, cka);
+		if (lastError)
+			*lastError = QObject::tr("%1\nline: %2, column: %3").arg(xsr.errorString()).arg(xsr.lineNumber()).arg(xsr.columnNumber());
+
+		return false;
 	}
 
+	if (monitor)
+		monitor->onProgress(fileSize, fileSize);
+
 	// done
 	return true;
 }
 
 
-bool CFormatGraphML::readAttrKey(int /*index*/, const QDomNode& domNode, Graph& graph, KeyAttrMap& cka) const
+bool CFormatGraphML::readAttrKey(int /*index*/, QXmlStreamReader &xsr, Graph& graph, KeyAttrMap& cka) const
 {
-	QDomElement elem = domNode.toElement();
+	QXmlStreamAttributes elemAttrs = xsr.attributes();
 
-	QString attrId = elem.attribute("id", "");
-	QString classId = elem.attribute("for", "");
-	QString nameId = elem.attribute("attr.name", "");
-	QString valueType = elem.attribute("attr.type", "");
+	QString attrId = elemAttrs.value("id").toString();
+	QString classId = elemAttrs.value("for").toString();
+	QString nameId = elemAttrs.value("attr.name").toString();
+	QString valueType = elemAttrs.value("attr.type").toString();
+
+	// text of the element including <default>
+	QString text = xsr.readElementText(QXmlStreamReader::IncludeChildElements);
 
 	if (attrId.isEmpty())
 		return false;
@@ -215,29 +240,37 @@ bool CFormatGraphML::readAttrKey(int /*index*/, const QDomNode& domNode, Graph&
 	attr.id = attrId.toLatin1();
 	attr.name = nameId.isEmpty() ? attrId : nameId;
 
-	if (valueType == "integer" || valueType == "long") {
+	// no default value: the one of the editor (if any) is kept
+	if (text.isEmpty()) {
+		attr.valueType = (valueType == "integer" || valueType == "long") ? QVariant::Int :
+			(valueType == "double") ? QVariant::Double :
+			(valueType == "float") ? QMetaType::Float :
+			(valueType == "boolean") ? QMetaType::Bool :
+			QMetaType::QString;
+	}
+	else if (valueType == "integer" || valueType == "long") {
 		attr.valueType = QVariant::Int;
-		attr.defaultValue.setValue(elem.text().toInt());
+		attr.defaultValue.setValue(text.toInt());
 	}
 	//else if (valueType == "long") {
 	//	attr.valueType = QVariant::LongLong;
-	//	attr.defaultValue.setValue(elem.text().toLongLong());
+	//	attr.defaultValue.setValue(text.toLongLong());
 	//}
 	else if (valueType == "double") {
 		attr.valueType = QVariant::Double;
-		attr.defaultValue.setValue(elem.text().toDouble());
+		attr.defaultValue.setValue(text.toDouble());
 	}
 	else if (valueType == "float") {
 		attr.valueType = QMetaType::Float;
-		attr.defaultValue.setValue(elem.text().toFloat());
+		attr.defaultValue.setValue(text.toFloat());
 	}
 	else if (valueType == "boolean") {
 		attr.valueType = QMetaType::Bool;
-		attr.defaultValue.setValue(!!elem.text().toInt());
+		attr.defaultValue.setValue(!!text.toInt());
 	}
 	else {
 		attr.valueType = QMetaType::QString;
-		attr.defaultValue.setValue(elem.text());
+		attr.defaultValue.setValue(text);
 	}
 
 	QByteArray attrClassId = classId.toLower().toLatin1();
@@ -256,55 +289,77 @@ bool CFormatGraphML::readAttrKey(int /*index*/, const QDomNode& domNode, Graph&
 }
 
 
-bool CFormatGraphML::readNode(int /*index*/, const QDomNode &domNode, Graph& graph, const KeyAttrMap& cka) const
+bool CFormatGraphML::readNode(int index, QXmlStreamReader &xsr, Graph& graph, const KeyAttrMap& cka) const
 {
-	QDomElement elem = domNode.toElement();
-
 	Node node;
 
 	// common attrs
-	auto id = elem.attribute("id", "").toLocal8Bit();
+	auto id = xsr.attributes().value("id").toString().toLocal8Bit();
 	node.id = id;
 
-	QDomNodeList data = elem.elementsByTagName("data");
-	for (int i = 0; i < data.count(); ++i)
+	// children (data of the ports are assigned to the node as well)
+	int depth = 1;
+	while (depth > 0 && !xsr.atEnd())
 	{
-		QDomNode dm = data.at(i);
-		QDomElement de = dm.toElement();
-
-		QString key = de.attribute("key", "");
-		ClassAttrId classAttrId = cka[key.toLocal8Bit()];
-		QByteArray attrId = classAttrId.second;
+		auto token = xsr.readNext();
 
-		if (!attrId.isEmpty())
+		if (token == QXmlStreamReader::EndElement)
 		{
-			node.attrs[attrId] = de.text();
-
-			if (attrId == "tooltip")
-				node.attrs["label"] = de.text();
-			else
-			if (attrId == "x_coordinate")
-				node.attrs["x"] = de.text();
-			else
-			if (attrId == "y_coordinate")
-				node.attrs["y"] = de.text();
+			depth--;
+			continue;
 		}
-	}
-
-	// ports
-	QDomNodeList portNodes = elem.elementsByTagName("port");
-	for (int i = 0; i < data.count(); ++i)
-	{
-		QDomNode dm = data.at(i);
-		QDomElement de = dm.toElement();
 
-		QString portName = de.attribute("name", "");
-		if (portName.isEmpty())
+		if (token != QXmlStreamReader::StartElement)
 			continue;
 
-		NodePort port;
-		port.name = portName;
-		node.ports[portName] = port;
+		auto name = xsr.name();
+
+		if (name == "data")
+		{
+			QString key = xsr.attributes().value("key").toString();
+			QString text = xsr.readElementText(QXmlStreamReader::IncludeChildElements);
+
+			ClassAttrId classAttrId = cka[key.toLocal8Bit()];
+			QByteArray attrId = classAttrId.second;
+
+			if (!attrId.isEmpty())
+			{
+				node.attrs[attrId] = text;
+
+				if (attrId == "tooltip")
+					node.attrs["label"] = text;
+				else
+				if (attrId == "x_coordinate")
+					node.attrs["x"] = text;
+				else
+				if (attrId == "y_coordinate")
+					node.attrs["y"] = text;
+			}
+		}
+		else if (name == "node")
+		{
+			// nested graphs are flattened
+			readNode(index, xsr, graph, cka);
+		}
+		else if (name == "edge")
+		{
+			readEdge(index, xsr, graph, cka);
+		}
+		else
+		{
+			if (name == "port")
+			{
+				QString portName = xsr.attributes().value("name").toString();
+				if (!portName.isEmpty())
+				{
+					NodePort port;
+					port.name = portName;
+					node.ports[portName] = port;
+				}
+			}
+
+			depth++;
+		}
 	}
 
 	graph.nodes.append(node);
@@ -313,37 +368,50 @@ bool CFormatGraphML::readNode(int /*index*/, const QDomNode &domNode, Graph& gra
 }
 
 
-bool CFormatGraphML::readEdge(int /*index*/, const QDomNode &domNode, Graph& graph, const KeyAttrMap& cka) const
+bool CFormatGraphML::readEdge(int /*index*/, QXmlStreamReader &xsr, Graph& graph, const KeyAttrMap& cka) const
 {
-	QDomElement elem = domNode.toElement();
-	
+	QXmlStreamAttributes elemAttrs = xsr.attributes();
+
 	Edge edge;
-	edge.startNodeId = elem.attribute("source", "").toLocal8Bit();
-	edge.startPortId = elem.attribute("sourceport", "").toLocal8Bit();
-	edge.endNodeId = elem.attribute("target", "").toLocal8Bit();
-	edge.endPortId = elem.attribute("targetport", "").toLocal8Bit();
+	edge.startNodeId = elemAttrs.value("source").toString().toLocal8Bit();
+	edge.startPortId = elemAttrs.value("sourceport").toString().toLocal8Bit();
+	edge.endNodeId = elemAttrs.value("target").toString().toLocal8Bit();
+	edge.endPortId = elemAttrs.value("targetport").toString().toLocal8Bit();
 
 	// common attrs
-	QString id = elem.attribute("id", "");
+	QString id = elemAttrs.value("id").toString();
 	edge.id = id.toLocal8Bit();
 
-	QDomNodeList data = elem.elementsByTagName("data");
-	for (int i = 0; i < data.count(); ++i)
+	int depth = 1;
+	while (depth > 0 && !xsr.atEnd())
 	{
-		QDomNode dm = data.at(i);
-		QDomElement de = dm.toElement();
+		auto token = xsr.readNext();
+
+		if (token == QXmlStreamReader::EndElement)
+		{
+			depth--;
+			continue;
+		}
 
-		QString key = de.attribute("key", "");
-		QByteArray attrId = cka[key.toLatin1()].second;
-		if (!attrId.isEmpty())
+		if (token != QXmlStreamReader::StartElement)
+			continue;
+
+		if (xsr.name() == "data")
 		{
-			edge.attrs[attrId] = de.text();
+			QString key = xsr.attributes().value("key").toString();
+			QString text = xsr.readElementText(QXmlStreamReader::IncludeChildElements);
+
+			QByteArray attrId = cka[key.toLatin1()].second;
+			if (!attrId.isEmpty())
+			{
+				edge.attrs[attrId] = text;
+			}
 		}
+		else
+			depth++;
 	}
 
 	graph.edges.append(edge);
 
 	return true;
 }
-
-
@@ -9,28 +9,30 @@ It can be used freely, maintaining the information above.
 
 #pragma once
 
-#include <QtXml/QDomDocument>
 #include <QMap>
 #include <QByteArray>
 #include <QVariant>
+#include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
 #include <qvgeio/CGraphBase.h>
+#include <qvgeio/IProgressMonitor.h>
 
 
 class CFormatGraphML
 {
 public:
-	bool load(const QString& fileName, Graph& graph, QString* lastError = nullptr) const;
+	bool load(const QString& fileName, Graph& graph, QString* lastError = nullptr, IProgressMonitor* monitor = nullptr) const;
 	bool save(const QString& fileName, Graph& graph, QString* lastError = nullptr) const;
 
 private:
 	typedef QPair<QByteArray, QByteArray> ClassAttrId;
 	typedef QMap<QByteArray, ClassAttrId> KeyAttrMap;
 
-	bool readAttrKey(int index, const QDomNode &domNode, Graph& graph, KeyAttrMap& cka) const;
-	bool readNode(int index, const QDomNode &domNode, Graph& graph, const KeyAttrMap& cka) const;
-	bool readEdge(int index, const QDomNode &domNode, Graph& graph, const KeyAttrMap& cka) const;
+	// the reader is positioned at the start element & leaves it at the end element
+	bool readAttrKey(int index, QXmlStreamReader &xsr, Graph& graph, KeyAttrMap& cka) const;
+	bool readNode(int index, QXmlStreamReader &xsr, Graph& graph, const KeyAttrMap& cka) const;
+	bool readEdge(int index, QXmlStreamReader &xsr, Graph& graph, const KeyAttrMap& cka) const;
 
 	void writeAttributes(QXmlStreamWriter &xsw, const AttributeInfos &attrs, const QByteArray &classId) const;
 	void writeNodes(QXmlStreamWriter &xsw, const Graph& graph) const;
@@ -19,5 +19,7 @@ void Graph::clear()
 	nodeAttrs.clear();
 	edgeAttrs.clear();
 	graphAttrs.clear();
+
+	visibleAttrs.clear();
 }
 
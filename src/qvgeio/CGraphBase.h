@@ -13,6 +13,7 @@ It can be used freely, maintaining the information above.
 #include <QByteArray>
 #include <QVariant>
 #include <QList>
+#include <QSet>
 
 
 typedef QMap<QByteArray, QVariant> GraphAttributes;
@@ -68,6 +69,9 @@ struct Graph
 	AttributeInfos edgeAttrs;
 	AttributeInfos graphAttrs;
 
+	// ids of the attributes shown on the items, by class ids ("" for the graph)
+	QMap<QByteArray, QSet<QByteArray>> visibleAttrs;
+
 	// methods
 	void clear();
 };
@@ -0,0 +1,24 @@
+/*
+This file is a part of
+QVGE - Qt Visual Graph Editor
+
+(c) 2016-2019 Ars L. Masiuk (ars.masiuk@gmail.com)
+
+It can be used freely, maintaining the information above.
+*/
+
+#pragma once
+
+#include <QtGlobal>
+
+
+/**
+	Receives progress of long operations (reading/writing of the files etc).
+*/
+class IProgressMonitor
+{
+public:
+	// value & total are in units of the operation (i.e. bytes);
+	// returns false if the operation has to be cancelled
+	virtual bool onProgress(qint64 value, qint64 total) = 0;
+};